@@ -0,0 +1,403 @@
+#include "audio_graph.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GRAPH_MIC_SINK "soundboard_output"
+#define GRAPH_LOCAL_SINK "soundboard_local"
+#define GRAPH_COMBINED_SINK "soundboard_combined"
+#define GRAPH_RETRY_USEC 1000000
+
+static void connect_context(AudioGraph *graph);
+static void refresh(AudioGraph *graph, int lists);
+
+static int has_name(char (*names)[GRAPH_NAME_MAX], int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+static unsigned bus_sinks_present(AudioGraph *graph) {
+    unsigned present = 0;
+    for (int b = 0; b < graph->routing.bus_count; b++) {
+        if (has_name(graph->view.sinks, graph->view.sink_count, graph->routing.buses[b].sink)) {
+            present |= 1u << b;
+        }
+    }
+    return present;
+}
+// Ours if the arguments mention a soundboard device or create one of the bus sinks
+static int is_soundboard_module(AudioGraph *graph, const GraphModule *module) {
+    if (strstr(module->argument, "soundboard")) return 1;
+    for (int b = 0; b < graph->routing.bus_count; b++) {
+        char needle[GRAPH_NAME_MAX + 16];
+        snprintf(needle, sizeof(needle), "sink_name=%s", graph->routing.buses[b].sink);
+        const char *found = strstr(module->argument, needle);
+        if (found && (found[strlen(needle)] == ' ' || found[strlen(needle)] == '\0')) return 1;
+    }
+    return 0;
+}
+static void request_done(AudioGraph *graph) {
+    if (--graph->pending == 0) {
+        refresh(graph, GRAPH_ALL);  // pick up what the batch changed before anyone reads the view
+        pa_threaded_mainloop_signal(graph->mainloop, 0);
+    }
+}
+static void module_loaded(pa_context *context, uint32_t index, void *data) {
+    if (index == PA_INVALID_INDEX) {
+        printf("Warning: Could not load a soundboard module: %s\n", pa_strerror(pa_context_errno(context)));
+    }
+    request_done(data);
+}
+static void module_unloaded(pa_context *context, int success, void *data) {
+    if (!success) {
+        printf("Warning: Could not unload a soundboard module: %s\n", pa_strerror(pa_context_errno(context)));
+    }
+    request_done(data);
+}
+// Requests on one connection are handled in order, so a batch can refer to
+// sinks created earlier in the same batch without waiting in between
+static void load(AudioGraph *graph, const char *module, const char *argument) {
+    pa_operation *op = pa_context_load_module(graph->context, module, argument, module_loaded, graph);
+    if (op) {
+        graph->pending++;
+        pa_operation_unref(op);
+    }
+}
+static void local_volume(pa_context *context, const pa_sink_info *info, int eol, void *data) {
+    if (eol) {
+        request_done(data);
+        return;
+    }
+    pa_cvolume volume;
+    pa_cvolume_set(&volume, info->channel_map.channels, PA_VOLUME_NORM / 2);
+    pa_operation *op = pa_context_set_sink_volume_by_name(context, info->name, &volume, NULL, NULL);
+    if (op) pa_operation_unref(op);
+}
+// Create whatever is missing from the cached view
+static void build(AudioGraph *graph) {
+    GraphView *view = &graph->view;
+    int before = graph->pending;
+    graph->build_requested = 0;
+    if (!has_name(view->sinks, view->sink_count, GRAPH_MIC_SINK)) {
+        char argument[GRAPH_ARGUMENT_MAX];
+        printf("Setting up virtual microphone with real mic passthrough...\n");
+        load(graph, "module-null-sink", "sink_name=" GRAPH_MIC_SINK " sink_properties=device.description=Soundboard-Output");
+        load(graph, "module-null-sink", "sink_name=" GRAPH_LOCAL_SINK " sink_properties=device.description=Soundboard-Headphones");
+        load(graph, "module-null-sink", "sink_name=" GRAPH_COMBINED_SINK " sink_properties=device.description=Soundboard-Combined");
+        // Never loop our own devices back into themselves if one became the default
+        if (view->default_source[0] && !strstr(view->default_source, "soundboard")) {
+            snprintf(argument, sizeof(argument), "source=%s sink=" GRAPH_COMBINED_SINK " latency_msec=1",
+                     view->default_source);
+            load(graph, "module-loopback", argument);
+        }
+        load(graph, "module-loopback", "source=" GRAPH_MIC_SINK ".monitor sink=" GRAPH_COMBINED_SINK " latency_msec=1");
+        if (view->default_sink[0] && !strstr(view->default_sink, "soundboard")) {
+            snprintf(argument, sizeof(argument), "source=" GRAPH_LOCAL_SINK ".monitor sink=%s latency_msec=1",
+                     view->default_sink);
+            load(graph, "module-loopback", argument);
+        }
+        load(graph, "module-remap-source", "source_name=" GRAPH_MIC_SINK "_mic source_properties=device.description=SB-Microphone "
+             "master=" GRAPH_COMBINED_SINK ".monitor");
+        pa_operation *op = pa_context_get_sink_info_by_name(graph->context, GRAPH_LOCAL_SINK, local_volume, graph);
+        if (op) {
+            graph->pending++;
+            pa_operation_unref(op);
+        }
+    }
+    for (int b = 0; b < graph->routing.bus_count; b++) {
+        const char *sink = graph->routing.buses[b].sink;
+        if (strcmp(sink, GRAPH_MIC_SINK) == 0 || strcmp(sink, GRAPH_LOCAL_SINK) == 0 ||
+            has_name(view->sinks, view->sink_count, sink)) {
+            continue;
+        }
+        char argument[GRAPH_ARGUMENT_MAX];
+        snprintf(argument, sizeof(argument), "sink_name=%s sink_properties=device.description=Soundboard-Bus-%s",
+                 sink, graph->routing.buses[b].name);
+        printf("Creating sink %s for bus %s\n", sink, graph->routing.buses[b].name);
+        load(graph, "module-null-sink", argument);
+    }
+    if (graph->pending > before) graph->builds++;
+}
+static void finish_list(AudioGraph *graph, int list) {
+    GraphView *view = &graph->view, *next = &graph->next;
+    if (list == GRAPH_SINKS) {
+        memcpy(view->sinks, next->sinks, next->sink_count * sizeof(next->sinks[0]));
+        view->sink_count = next->sink_count;
+    } else if (list == GRAPH_SOURCES) {
+        memcpy(view->sources, next->sources, next->source_count * sizeof(next->sources[0]));
+        view->source_count = next->source_count;
+    } else if (list == GRAPH_MODULES) {
+        memcpy(view->modules, next->modules, next->module_count * sizeof(next->modules[0]));
+        view->module_count = next->module_count;
+    } else {
+        memcpy(view->default_sink, next->default_sink, sizeof(view->default_sink));
+        memcpy(view->default_source, next->default_source, sizeof(view->default_source));
+    }
+    graph->refreshing &= ~list;
+    if (graph->stale & list) {
+        graph->stale &= ~list;
+        refresh(graph, list);
+    }
+    if (graph->refreshing) return;
+    // The whole view is current: act on it
+    if (graph->build_requested && graph->wanted && graph->pending == 0) {
+        build(graph);
+    }
+    if (graph->on_change) {
+        graph->on_change(graph->change_data, bus_sinks_present(graph));
+    }
+    pa_threaded_mainloop_signal(graph->mainloop, 0);
+}
+static void sink_listed(pa_context *context, const pa_sink_info *info, int eol, void *data) {
+    AudioGraph *graph = data;
+    if (eol) {
+        finish_list(graph, GRAPH_SINKS);
+    } else if (graph->next.sink_count < GRAPH_MAX_ITEMS) {
+        snprintf(graph->next.sinks[graph->next.sink_count++], GRAPH_NAME_MAX, "%s", info->name);
+    }
+}
+static void source_listed(pa_context *context, const pa_source_info *info, int eol, void *data) {
+    AudioGraph *graph = data;
+    if (eol) {
+        finish_list(graph, GRAPH_SOURCES);
+    } else if (graph->next.source_count < GRAPH_MAX_ITEMS) {
+        snprintf(graph->next.sources[graph->next.source_count++], GRAPH_NAME_MAX, "%s", info->name);
+    }
+}
+static void module_listed(pa_context *context, const pa_module_info *info, int eol, void *data) {
+    AudioGraph *graph = data;
+    if (eol) {
+        finish_list(graph, GRAPH_MODULES);
+    } else if (graph->next.module_count < GRAPH_MAX_ITEMS) {
+        GraphModule *module = &graph->next.modules[graph->next.module_count++];
+        module->index = info->index;
+        snprintf(module->name, sizeof(module->name), "%s", info->name);
+        snprintf(module->argument, sizeof(module->argument), "%s", info->argument ? info->argument : "");
+    }
+}
+static void server_listed(pa_context *context, const pa_server_info *info, void *data) {
+    AudioGraph *graph = data;
+    snprintf(graph->next.default_sink, GRAPH_NAME_MAX, "%s", info && info->default_sink_name ? info->default_sink_name : "");
+    snprintf(graph->next.default_source, GRAPH_NAME_MAX, "%s", info && info->default_source_name ? info->default_source_name : "");
+    finish_list(graph, GRAPH_SERVER);
+}
+// Re-read the given lists; a list already being read is read once more afterwards
+static void refresh(AudioGraph *graph, int lists) {
+    if (!graph->connected) return;
+    for (int list = GRAPH_SINKS; list <= GRAPH_SERVER; list <<= 1) {
+        if (!(lists & list)) continue;
+        if (graph->refreshing & list) {
+            graph->stale |= list;
+            continue;
+        }
+        pa_operation *op = NULL;
+        if (list == GRAPH_SINKS) {
+            graph->next.sink_count = 0;
+            op = pa_context_get_sink_info_list(graph->context, sink_listed, graph);
+        } else if (list == GRAPH_SOURCES) {
+            graph->next.source_count = 0;
+            op = pa_context_get_source_info_list(graph->context, source_listed, graph);
+        } else if (list == GRAPH_MODULES) {
+            graph->next.module_count = 0;
+            op = pa_context_get_module_info_list(graph->context, module_listed, graph);
+        } else {
+            op = pa_context_get_server_info(graph->context, server_listed, graph);
+        }
+        if (op) {
+            graph->refreshing |= list;
+            pa_operation_unref(op);
+        }
+    }
+}
+static void server_event(pa_context *context, pa_subscription_event_type_t type, uint32_t index, void *data) {
+    AudioGraph *graph = data;
+    graph->events++;
+    switch (type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+            refresh(graph, GRAPH_SINKS);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+            refresh(graph, GRAPH_SOURCES);
+            break;
+        case PA_SUBSCRIPTION_EVENT_MODULE:
+            refresh(graph, GRAPH_MODULES);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+            refresh(graph, GRAPH_SERVER);
+            break;
+    }
+}
+static void retry_connect(pa_mainloop_api *api, pa_time_event *event, const struct timeval *tv, void *data) {
+    AudioGraph *graph = data;
+    api->time_free(event);
+    if (graph->stopping) return;
+    graph->reconnects++;
+    connect_context(graph);
+}
+static void schedule_reconnect(AudioGraph *graph) {
+    pa_mainloop_api *api = pa_threaded_mainloop_get_api(graph->mainloop);
+    struct timeval when;
+    pa_gettimeofday(&when);
+    pa_timeval_add(&when, GRAPH_RETRY_USEC);
+    api->time_new(api, &when, retry_connect, graph);
+}
+static void state_changed(pa_context *context, void *data) {
+    AudioGraph *graph = data;
+    if (context != graph->context) return;
+    pa_context_state_t state = pa_context_get_state(context);
+    if (state == PA_CONTEXT_READY) {
+        graph->connected = 1;
+        pa_context_set_subscribe_callback(context, server_event, graph);
+        pa_operation *op = pa_context_subscribe(context,
+                                                PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE |
+                                                PA_SUBSCRIPTION_MASK_MODULE | PA_SUBSCRIPTION_MASK_SERVER,
+                                                NULL, NULL);
+        if (op) pa_operation_unref(op);
+        // A fresh server (or a restarted one) has none of our devices
+        graph->build_requested = graph->wanted;
+        refresh(graph, GRAPH_ALL);
+        pa_threaded_mainloop_signal(graph->mainloop, 0);
+    } else if (state == PA_CONTEXT_FAILED || state == PA_CONTEXT_TERMINATED) {
+        // Outstanding requests died with the connection
+        int was_connected = graph->connected;
+        graph->connected = 0;
+        graph->refreshing = graph->stale = graph->pending = 0;
+        memset(&graph->view, 0, sizeof(graph->view));
+        if (!graph->stopping) {
+            if (was_connected) printf("Audio server connection lost, waiting for it to come back...\n");
+            schedule_reconnect(graph);
+        }
+        pa_threaded_mainloop_signal(graph->mainloop, 0);
+    }
+}
+static void connect_context(AudioGraph *graph) {
+    if (graph->context) {
+        pa_context_set_state_callback(graph->context, NULL, NULL);
+        pa_context_disconnect(graph->context);
+        pa_context_unref(graph->context);
+    }
+    graph->context = pa_context_new(pa_threaded_mainloop_get_api(graph->mainloop), "Soundboard");
+    if (!graph->context) {
+        schedule_reconnect(graph);
+        return;
+    }
+    pa_context_set_state_callback(graph->context, state_changed, graph);
+    // NOFAIL: with no server running yet, wait for one to appear instead of failing
+    if (pa_context_connect(graph->context, NULL, PA_CONTEXT_NOFAIL, NULL) < 0) {
+        schedule_reconnect(graph);
+    }
+}
+int audio_graph_start(AudioGraph *graph, const Routing *routing, GraphChangeFn on_change, void *data) {
+    memset(graph, 0, sizeof(*graph));
+    graph->routing = *routing;
+    graph->wanted = 1;
+    graph->on_change = on_change;
+    graph->change_data = data;
+    graph->mainloop = pa_threaded_mainloop_new();
+    if (!graph->mainloop) {
+        printf("Error: Failed to create audio server main loop\n");
+        return 0;
+    }
+    pa_threaded_mainloop_lock(graph->mainloop);
+    connect_context(graph);
+    pa_threaded_mainloop_unlock(graph->mainloop);
+    if (pa_threaded_mainloop_start(graph->mainloop) < 0) {
+        printf("Error: Failed to start audio server thread\n");
+        pa_threaded_mainloop_free(graph->mainloop);
+        graph->mainloop = NULL;
+        return 0;
+    }
+    return 1;
+}
+void audio_graph_stop(AudioGraph *graph) {
+    if (!graph->mainloop) return;
+    pa_threaded_mainloop_lock(graph->mainloop);
+    graph->stopping = 1;
+    if (graph->context) {
+        pa_context_set_state_callback(graph->context, NULL, NULL);
+        pa_context_disconnect(graph->context);
+        pa_context_unref(graph->context);
+        graph->context = NULL;
+    }
+    pa_threaded_mainloop_unlock(graph->mainloop);
+    pa_threaded_mainloop_stop(graph->mainloop);
+    pa_threaded_mainloop_free(graph->mainloop);
+    graph->mainloop = NULL;
+}
+int audio_graph_wait_connected(AudioGraph *graph, int timeout_ms) {
+    for (int waited = 0;; waited += 50) {
+        pa_threaded_mainloop_lock(graph->mainloop);
+        int connected = graph->connected;
+        pa_threaded_mainloop_unlock(graph->mainloop);
+        if (connected || waited >= timeout_ms) return connected;
+        usleep(50000);
+    }
+}
+// Block until the view is fresh and no request is outstanding (mainloop locked)
+static void wait_idle(AudioGraph *graph) {
+    while (graph->connected && (graph->build_requested || graph->refreshing || graph->pending)) {
+        pa_threaded_mainloop_wait(graph->mainloop);
+    }
+}
+int audio_graph_setup(AudioGraph *graph) {
+    pa_threaded_mainloop_lock(graph->mainloop);
+    graph->wanted = 1;
+    graph->build_requested = 1;
+    refresh(graph, GRAPH_ALL);  // build() runs as soon as the view is current
+    wait_idle(graph);
+    int ok = graph->connected;
+    pa_threaded_mainloop_unlock(graph->mainloop);
+    return ok;
+}
+int audio_graph_teardown(AudioGraph *graph) {
+    pa_threaded_mainloop_lock(graph->mainloop);
+    graph->wanted = 0;
+    graph->build_requested = 0;
+    refresh(graph, GRAPH_MODULES);
+    wait_idle(graph);
+    // Newest first, so loopbacks and the remapped mic go before the sinks they use
+    for (int i = graph->view.module_count - 1; graph->connected && i >= 0; i--) {
+        GraphModule *module = &graph->view.modules[i];
+        if (!is_soundboard_module(graph, module)) continue;
+        pa_operation *op = pa_context_unload_module(graph->context, module->index, module_unloaded, graph);
+        if (op) {
+            graph->pending++;
+            pa_operation_unref(op);
+        }
+    }
+    wait_idle(graph);
+    int ok = graph->connected;
+    pa_threaded_mainloop_unlock(graph->mainloop);
+    return ok;
+}
+void audio_graph_set_buses(AudioGraph *graph, const Routing *routing) {
+    pa_threaded_mainloop_lock(graph->mainloop);
+    graph->routing = *routing;
+    if (graph->wanted) {
+        graph->build_requested = 1;
+        refresh(graph, GRAPH_ALL);
+    }
+    pa_threaded_mainloop_unlock(graph->mainloop);
+}
+void audio_graph_describe(AudioGraph *graph, char *reply, size_t reply_size) {
+    pa_threaded_mainloop_lock(graph->mainloop);
+    int modules = 0;
+    for (int i = 0; i < graph->view.module_count; i++) {
+        if (is_soundboard_module(graph, &graph->view.modules[i])) modules++;
+    }
+    unsigned present = bus_sinks_present(graph);
+    int buses = 0;
+    for (int b = 0; b < graph->routing.bus_count; b++) {
+        if (present & (1u << b)) buses++;
+    }
+    snprintf(reply, reply_size,
+             "server %s, %d soundboard modules, %d/%d bus sinks, mic source %s, default sink %s, default source %s, "
+             "%lu events, %lu builds, %lu reconnects",
+             graph->connected ? "connected" : "unreachable", modules, buses, graph->routing.bus_count,
+             has_name(graph->view.sources, graph->view.source_count, GRAPH_MIC_SINK "_mic") ? "present" : "missing",
+             graph->view.default_sink[0] ? graph->view.default_sink : "?",
+             graph->view.default_source[0] ? graph->view.default_source : "?",
+             graph->events, graph->builds, graph->reconnects);
+    pa_threaded_mainloop_unlock(graph->mainloop);
+}
@@ -0,0 +1,71 @@
+#ifndef AUDIO_GRAPH_H
+#define AUDIO_GRAPH_H
+#include <stdint.h>
+#include <pulse/pulseaudio.h>
+#include "routing.h"
+// The soundboard's virtual devices (null sinks, loopbacks, SB-Microphone and
+// one sink per extra bus), managed over a single persistent server connection.
+// Module loads are issued back to back and acknowledged together. Sinks,
+// sources, modules and the server defaults are cached and refreshed from
+// subscription events. If the server goes away the connection is retried
+// until it returns, then the graph is rebuilt.
+#define GRAPH_MAX_ITEMS 128
+#define GRAPH_NAME_MAX 128
+#define GRAPH_ARGUMENT_MAX 256
+#define GRAPH_SINKS 1
+#define GRAPH_SOURCES 2
+#define GRAPH_MODULES 4
+#define GRAPH_SERVER 8
+#define GRAPH_ALL (GRAPH_SINKS | GRAPH_SOURCES | GRAPH_MODULES | GRAPH_SERVER)
+typedef struct {
+    uint32_t index;
+    char name[GRAPH_NAME_MAX];
+    char argument[GRAPH_ARGUMENT_MAX];
+} GraphModule;
+// One snapshot of the server's objects
+typedef struct {
+    char sinks[GRAPH_MAX_ITEMS][GRAPH_NAME_MAX];
+    int sink_count;
+    char sources[GRAPH_MAX_ITEMS][GRAPH_NAME_MAX];
+    int source_count;
+    GraphModule modules[GRAPH_MAX_ITEMS];
+    int module_count;
+    char default_sink[GRAPH_NAME_MAX];
+    char default_source[GRAPH_NAME_MAX];
+} GraphView;
+// Called from the server thread after a refresh with a bit set for every bus whose sink exists
+typedef void (*GraphChangeFn)(void *data, unsigned bus_sinks_present);
+typedef struct {
+    pa_threaded_mainloop *mainloop;
+    pa_context *context;
+    // Everything below is guarded by the mainloop lock
+    int connected;
+    int stopping;
+    int wanted;             // keep the devices present (cleared by teardown)
+    int build_requested;     // create whatever is missing once the view is fresh
+    Routing routing;         // buses that need a sink
+    GraphView view;          // cached, kept current by server events
+    GraphView next;          // lists being fetched
+    int refreshing;          // GRAPH_ bits being fetched
+    int stale;               // GRAPH_ bits that changed again mid-fetch
+    int pending;             // module loads/unloads awaiting an answer
+    unsigned long events;
+    unsigned long builds;
+    unsigned long reconnects;
+    GraphChangeFn on_change;
+    void *change_data;
+} AudioGraph;
+
+// Connect (retrying in the background until a server is there) and build the graph
+int audio_graph_start(AudioGraph *graph, const Routing *routing, GraphChangeFn on_change, void *data);
+void audio_graph_stop(AudioGraph *graph);
+// Wait up to timeout_ms for the connection; returns 1 once connected
+int audio_graph_wait_connected(AudioGraph *graph, int timeout_ms);
+// Create the devices that are missing and wait for the server to confirm. Returns 0 if not connected.
+int audio_graph_setup(AudioGraph *graph);
+// Unload every soundboard module and stop keeping the graph alive
+int audio_graph_teardown(AudioGraph *graph);
+// New bus list: creates sinks for new buses if the graph is wanted
+void audio_graph_set_buses(AudioGraph *graph, const Routing *routing);
+void audio_graph_describe(AudioGraph *graph, char *reply, size_t reply_size);
+#endif
@@ -0,0 +1,330 @@
+#include "bank.h"
+#include "mixer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+
+// "retrigger:<id>|<policy>" line, else the "engine:retrigger" default
+static int sound_retrigger(ConfigStore *store, const char *id, int fallback) {
+    char name[64];
+    snprintf(name, sizeof(name), "retrigger:%s", id);
+    const char *policy = config_store_option(store, name, NULL);
+    if (!policy) return fallback;
+    int retrigger = mixer_parse_retrigger(policy);
+    if (retrigger < 0) {
+        printf("Warning: Unknown retrigger policy '%s' for sound #%s\n", policy, id);
+        return fallback;
+    }
+    return retrigger;
+}
+static void free_banks(Bank *banks, int bank_count) {
+    for (int i = 0; i < bank_count; i++) {
+        free(banks[i].slots);
+    }
+    free(banks);
+}
+// Collect the samples of the active bank and its neighbours, active bank first
+static int collect_window(BankSet *set, Sample ***out) {
+    Bank *active = atomic_load(&set->active);
+    if (!active || set->bank_count == 0) return 0;
+    int index = active->number - 1;
+    int window[3] = {index, (index + 1) % set->bank_count,
+                     (index + set->bank_count - 1) % set->bank_count};
+    int total = 0;
+    for (int w = 0; w < 3; w++) total += set->banks[window[w]].slot_count;
+    Sample **samples = malloc((total ? total : 1) * sizeof(Sample *));
+    if (!samples) return 0;
+    int count = 0;
+    for (int w = 0; w < 3; w++) {
+        if (w > 0 && window[w] == window[0]) continue;
+        if (w == 2 && window[2] == window[1]) continue;
+        Bank *bank = &set->banks[window[w]];
+        for (int i = 0; i < bank->slot_count; i++) {
+            samples[count++] = bank->slots[i].sample;
+        }
+    }
+    *out = samples;
+    return count;
+}
+static int has_path(char **paths, int count, const char *path) {
+    for (int i = 0; i < count; i++) {
+        if (paths[i] == path) return 1;  // one Sample (and path string) per file
+    }
+    return 0;
+}
+// Files a trigger could still need from disk: key-bound sounds outside the
+// decoded window, active bank first, then the most recently played others.
+// The paths belong to Samples, which live as long as the cache.
+static int collect_warm(BankSet *set, char ***out) {
+    Bank *active = atomic_load(&set->active);
+    char **paths = malloc((set->sound_count + 1) * sizeof(char *));  // every bound sample is also a sound
+    if (!paths || !active) {
+        free(paths);
+        return 0;
+    }
+    int count = 0;
+    pthread_mutex_lock(&set->cache->lock);
+    for (int b = 0; b < set->bank_count; b++) {
+        Bank *bank = &set->banks[(active->number - 1 + b) % set->bank_count];
+        for (int i = 0; i < bank->slot_count; i++) {
+            Sample *sample = bank->slots[i].sample;
+            if (!sample->in_window && !has_path(paths, count, sample->path)) paths[count++] = sample->path;
+        }
+    }
+    for (int n = 0; n < set->warm_recent; n++) {
+        Sample *recent = NULL;
+        for (int i = 0; i < set->sound_count; i++) {
+            Sample *sample = set->sounds[i].sample;
+            if (sample->last_used && !sample->in_window && !has_path(paths, count, sample->path) &&
+                (!recent || sample->last_used > recent->last_used)) {
+                recent = sample;
+            }
+        }
+        if (!recent) break;
+        paths[count++] = recent->path;
+    }
+    pthread_mutex_unlock(&set->cache->lock);
+    *out = paths;
+    return count;
+}
+// Decode queued triggers and start their voices
+static void play_queued(BankSet *set) {
+    for (;;) {
+        pthread_mutex_lock(&set->lock);
+        if (set->play_count == 0) {
+            pthread_mutex_unlock(&set->lock);
+            return;
+        }
+        QueuedPlay play = set->plays[0];
+        memmove(set->plays, set->plays + 1, --set->play_count * sizeof(QueuedPlay));
+        pthread_mutex_unlock(&set->lock);
+        if (!sample_cache_load(set->cache, play.sample)) {
+            printf("Error: Could not decode %s\n", play.sample->path);
+        } else {
+            mixer_play(set->mixer, play.sample, play.gains, play.retrigger);
+        }
+    }
+}
+static void yield_to_triggers(void *data) {
+    play_queued(data);
+}
+static void *loader_thread(void *data) {
+    BankSet *set = data;
+    pthread_mutex_lock(&set->lock);
+    while (set->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += set->warm_interval;
+        int timed_out = 0;
+        while (!set->loader_pending && !set->play_count && set->running) {
+            // Warmed pages age out of the cache again, so re-warm now and then
+            if (set->warm_interval <= 0) {
+                pthread_cond_wait(&set->wake, &set->lock);
+            } else if (pthread_cond_timedwait(&set->wake, &set->lock, &deadline) != 0) {
+                timed_out = 1;
+                break;
+            }
+        }
+        if (!set->running) break;
+        if (set->play_count) {
+            pthread_mutex_unlock(&set->lock);
+            play_queued(set);
+            pthread_mutex_lock(&set->lock);
+            if (!set->loader_pending && !timed_out) continue;
+        }
+        set->loader_pending = 0;
+        Sample **window = NULL;
+        int count = collect_window(set, &window);
+        pthread_mutex_unlock(&set->lock);
+
+        pthread_mutex_lock(&set->cache->lock);
+        for (int i = 0; i < set->cache->count; i++) {
+            set->cache->samples[i]->in_window = 0;
+        }
+        for (int i = 0; i < count; i++) {
+            window[i]->in_window = 1;
+        }
+        pthread_mutex_unlock(&set->cache->lock);
+        // Page idle banks out first so the window decode stays under budget
+        sample_cache_evict(set->cache, set->budget);
+        for (int i = 0; i < count; i++) {
+            sample_cache_load(set->cache, window[i]);
+            play_queued(set);  // a trigger should not wait for the whole window
+        }
+        sample_cache_evict(set->cache, set->budget);
+        if (set->cache->resident_bytes > set->budget) {
+            printf("Warning: active bank window needs %zu MB, budget is %zu MB\n",
+                   set->cache->resident_bytes >> 20, set->budget >> 20);
+        }
+        free(window);
+        pthread_mutex_lock(&set->lock);
+        char **warm = NULL;
+        int warm_count = collect_warm(set, &warm);
+        pthread_mutex_unlock(&set->lock);
+        prefetch_warm(set->prefetch, warm, warm_count, yield_to_triggers, set);
+        free(warm);
+        pthread_mutex_lock(&set->lock);
+    }
+    pthread_mutex_unlock(&set->lock);
+    return NULL;
+}
+static void wake_loader(BankSet *set) {
+    pthread_mutex_lock(&set->lock);
+    set->loader_pending = 1;
+    pthread_cond_signal(&set->wake);
+    pthread_mutex_unlock(&set->lock);
+}
+int bank_set_start(BankSet *set, SampleCache *cache, Prefetch *prefetch, Mixer *mixer, size_t budget) {
+    memset(set, 0, sizeof(*set));
+    set->cache = cache;
+    set->mixer = mixer;
+    set->prefetch = prefetch;
+    set->budget = budget;
+    set->running = 1;
+    pthread_mutex_init(&set->lock, NULL);
+    pthread_cond_init(&set->wake, NULL);
+    if (pthread_create(&set->loader, NULL, loader_thread, set) != 0) {
+        printf("Error: Failed to start bank loader thread\n");
+        return 0;
+    }
+    return 1;
+}
+void bank_set_stop(BankSet *set) {
+    pthread_mutex_lock(&set->lock);
+    set->running = 0;
+    pthread_cond_signal(&set->wake);
+    pthread_mutex_unlock(&set->lock);
+    pthread_join(set->loader, NULL);
+    free_banks(set->banks, set->bank_count);
+    free(set->sounds);
+    pthread_cond_destroy(&set->wake);
+    pthread_mutex_destroy(&set->lock);
+}
+int bank_set_load_config(BankSet *set, ConfigStore *store, const char *sound_dir, const Routing *routing) {
+    int sound_count = 0, bank_count = 1;
+    for (int i = 0; i < store->count; i++) {
+        ConfigEntry *entry = &store->entries[i];
+        if (!entry->id || !isdigit((unsigned char)entry->id[0])) continue;
+        sound_count++;
+        const char *key;
+        int bank = config_keybind_bank(entry->keybind, &key);
+        if (key[0] && bank > bank_count) bank_count = bank;
+    }
+    Bank *banks = calloc(bank_count, sizeof(Bank));
+    SoundSlot *sounds = calloc(sound_count ? sound_count : 1, sizeof(SoundSlot));
+    if (!banks || !sounds) {
+        free(banks);
+        free(sounds);
+        return 0;
+    }
+    for (int b = 0; b < bank_count; b++) {
+        banks[b].number = b + 1;
+        banks[b].slots = calloc(sound_count ? sound_count : 1, sizeof(KeySlot));
+    }
+    int default_retrigger = mixer_parse_retrigger(config_store_option(store, "engine:retrigger", "overlap"));
+    if (default_retrigger < 0) {
+        printf("Warning: Unknown engine:retrigger policy, using overlap\n");
+        default_retrigger = RETRIGGER_OVERLAP;
+    }
+    int warm_recent = atoi(config_store_option(store, "engine:warm_recent", "8"));
+    int warm_interval = atoi(config_store_option(store, "engine:warm_interval_s", "300"));
+    int loaded = 0;
+    for (int i = 0; i < store->count; i++) {
+        ConfigEntry *entry = &store->entries[i];
+        if (!entry->id || !isdigit((unsigned char)entry->id[0])) continue;
+        char path[4096];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", sound_dir, entry->filename);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        Sample *sample = sample_cache_get(set->cache, path);
+        if (!sample) continue;
+        SoundSlot *sound = &sounds[loaded++];
+        snprintf(sound->id, sizeof(sound->id), "%s", entry->id);
+        sound->sample = sample;
+        routing_sound_gains(routing, store, entry->id, sound->gains);
+        sound->retrigger = sound_retrigger(store, entry->id, default_retrigger);
+        const char *key;
+        int number = config_keybind_bank(entry->keybind, &key);
+        if (!key[0]) continue;
+        if (!number) {
+            printf("Warning: Ignoring keybind %s of sound #%s, banks go up to %d\n",
+                   entry->keybind, entry->id, CONFIG_MAX_BANKS);
+            continue;
+        }
+        Bank *bank = &banks[number - 1];
+        if (!bank->slots) continue;
+        KeySlot *slot = &bank->slots[bank->slot_count++];
+        snprintf(slot->key, sizeof(slot->key), "%s", key);
+        snprintf(slot->sound_id, sizeof(slot->sound_id), "%s", entry->id);
+        slot->sample = sample;
+        memcpy(slot->gains, sound->gains, sizeof(slot->gains));
+        slot->retrigger = sound->retrigger;
+    }
+    pthread_mutex_lock(&set->lock);
+    Bank *old_banks = set->banks;
+    int old_count = set->bank_count;
+    Bank *old_active = atomic_load(&set->active);
+    int active_number = old_active ? old_active->number : 1;
+    if (active_number > bank_count) active_number = 1;
+    SoundSlot *old_sounds = set->sounds;
+    set->banks = banks;
+    set->bank_count = bank_count;
+    set->sounds = sounds;
+    set->sound_count = loaded;
+    set->warm_recent = warm_recent;
+    set->warm_interval = warm_interval;
+    atomic_store(&set->active, &banks[active_number - 1]);
+    pthread_mutex_unlock(&set->lock);
+    free_banks(old_banks, old_count);
+    free(old_sounds);
+    printf("Loaded %d sounds in %d bank(s)\n", loaded, bank_count);
+    wake_loader(set);
+    return 1;
+}
+Bank *bank_set_switch(BankSet *set, int number) {
+    if (set->bank_count == 0) return NULL;
+    int index = ((number - 1) % set->bank_count + set->bank_count) % set->bank_count;
+    Bank *bank = &set->banks[index];
+    atomic_store(&set->active, bank);
+    // Everything this bank needs is already resident; the loader only shifts the window
+    wake_loader(set);
+    return bank;
+}
+Bank *bank_set_active(BankSet *set) {
+    return atomic_load(&set->active);
+}
+int bank_set_play_later(BankSet *set, Sample *sample, const float *gains, int retrigger) {
+    pthread_mutex_lock(&set->lock);
+    int queued = set->play_count < BANK_MAX_QUEUED;
+    if (queued) {
+        QueuedPlay *play = &set->plays[set->play_count++];
+        play->sample = sample;
+        memcpy(play->gains, gains, sizeof(play->gains));
+        play->retrigger = retrigger;
+        pthread_cond_signal(&set->wake);
+    }
+    pthread_mutex_unlock(&set->lock);
+    return queued;
+}
+void bank_set_warm(BankSet *set) {
+    wake_loader(set);
+}
+KeySlot *bank_lookup_key(Bank *bank, const char *key) {
+    for (int i = 0; bank && i < bank->slot_count; i++) {
+        if (strcmp(bank->slots[i].key, key) == 0) {
+            return &bank->slots[i];
+        }
+    }
+    return NULL;
+}
+SoundSlot *bank_set_find_sound(BankSet *set, const char *id) {
+    for (int i = 0; i < set->sound_count; i++) {
+        if (strcmp(set->sounds[i].id, id) == 0) {
+            return &set->sounds[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,78 @@
+#ifndef BANK_H
+#define BANK_H
+#include <pthread.h>
+#include <stdatomic.h>
+#include "config_store.h"
+#include "sample_cache.h"
+#include "routing.h"
+#include "prefetch.h"
+#include "mixer.h"
+// Sound banks: each bank is its own key -> sound table built from config.txt
+// ("2:KP_1" binds KP_1 in bank 2). Switching banks only swaps the active
+// pointer; a loader thread keeps the active bank and its next/previous
+// neighbours decoded and pages idle banks out under the memory budget.
+// After each pass it warms the page cache for the files of every other
+// key-bound sound (and the most recently played ones), which are the ones a
+// trigger may still have to read from disk.
+typedef struct {
+    char key[32];
+    Sample *sample;
+    char sound_id[16];
+    float gains[ROUTING_MAX_BUSES];
+    int retrigger;           // RETRIGGER_ policy from mixer.h
+} KeySlot;
+typedef struct {
+    int number;
+    KeySlot *slots;
+    int slot_count;
+} Bank;
+typedef struct {
+    char id[16];
+    Sample *sample;
+    float gains[ROUTING_MAX_BUSES];
+    int retrigger;
+} SoundSlot;
+#define BANK_MAX_QUEUED 16
+// A trigger of a paged-out sample, played by the loader once it is decoded
+typedef struct {
+    Sample *sample;
+    float gains[ROUTING_MAX_BUSES];
+    int retrigger;
+} QueuedPlay;
+typedef struct {
+    SampleCache *cache;
+    Mixer *mixer;
+    Bank *banks;
+    int bank_count;
+    SoundSlot *sounds;       // every sound by config ID, for "play <id>"
+    int sound_count;
+    Bank *_Atomic active;
+    size_t budget;
+    Prefetch *prefetch;
+    int warm_recent;         // also warm this many recently played unbound sounds
+    int warm_interval;       // seconds between warming passes, 0 = only after loads and switches
+    pthread_mutex_t lock;    // guards banks/sounds against the loader thread
+    pthread_cond_t wake;
+    pthread_t loader;
+    int loader_pending;
+    QueuedPlay plays[BANK_MAX_QUEUED];
+    int play_count;
+    int running;
+} BankSet;
+
+int bank_set_start(BankSet *set, SampleCache *cache, Prefetch *prefetch, Mixer *mixer, size_t budget);
+void bank_set_stop(BankSet *set);
+// Rebuild all key tables (and each sound's bus gains and retrigger policy) from the
+// config, keeping the active bank number
+int bank_set_load_config(BankSet *set, ConfigStore *store, const char *sound_dir, const Routing *routing);
+// Make bank `number` (1-based, wraps around) active and return it
+Bank *bank_set_switch(BankSet *set, int number);
+Bank *bank_set_active(BankSet *set);
+// Decode a paged-out sample on the loader thread and play it there, so the
+// caller never waits for the disk or the decoder. Returns 0 if the queue is full.
+int bank_set_play_later(BankSet *set, Sample *sample, const float *gains, int retrigger);
+// Run a loader pass (and so a warming pass) now
+void bank_set_warm(BankSet *set);
+KeySlot *bank_lookup_key(Bank *bank, const char *key);
+SoundSlot *bank_set_find_sound(BankSet *set, const char *id);
+#endif
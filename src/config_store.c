@@ -0,0 +1,548 @@
+#include "config_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+static char *xstrdup(const char *s) {
+    return strdup(s ? s : "");
+}
+static void free_entry(ConfigEntry *entry) {
+    free(entry->id);
+    free(entry->filename);
+    free(entry->keybind);
+    free(entry->description);
+    free(entry->raw);
+    memset(entry, 0, sizeof(*entry));
+}
+static ConfigEntry *append_entry(ConfigStore *store) {
+    if (store->count == store->capacity) {
+        int capacity = store->capacity ? store->capacity * 2 : 64;
+        ConfigEntry *entries = realloc(store->entries, capacity * sizeof(ConfigEntry));
+        if (!entries) {
+            printf("Error: Failed to allocate memory for config entries\n");
+            return NULL;
+        }
+        store->entries = entries;
+        store->capacity = capacity;
+    }
+    ConfigEntry *entry = &store->entries[store->count++];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+// Same cleanup the scan command applies: no pipes or control characters in a field
+static char *sanitize_field(const char *text) {
+    char *clean = xstrdup(text);
+    for (char *p = clean; *p; p++) {
+        if (*p == '|' || *p == '\n' || *p == '\r' || ((unsigned char)*p < 32 && *p != '\t')) {
+            *p = '?';
+        }
+    }
+    return clean;
+}
+// Split one config line into an entry; anything that is not a sound line is kept raw
+static int parse_line(ConfigStore *store, const char *line) {
+    ConfigEntry *entry = append_entry(store);
+    if (!entry) return 0;
+    char *copy = xstrdup(line);
+    copy[strcspn(copy, "\r\n")] = '\0';
+    char *fields[4] = {0};
+    int field = 0;
+    if (copy[0] != '#' && copy[0] != '\0') {
+        char *start = copy;
+        while (field < 4) {
+            fields[field++] = start;
+            // Description is everything after the third pipe, like bash `read`
+            char *end = (field < 4) ? strchr(start, '|') : NULL;
+            if (!end) break;
+            *end = '\0';
+            start = end + 1;
+        }
+    }
+    if (field < 4) {
+        entry->raw = xstrdup(line);
+        entry->raw[strcspn(entry->raw, "\r\n")] = '\0';
+    } else {
+        entry->id = xstrdup(fields[0]);
+        entry->filename = xstrdup(fields[1]);
+        entry->keybind = xstrdup(fields[2]);
+        entry->description = xstrdup(fields[3]);
+    }
+    free(copy);
+    return 1;
+}
+static int journal_append(ConfigStore *store, const char *op, const char *a, const char *b) {
+    int fd = open(store->journal_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        printf("Error: Could not open config journal: %s\n", store->journal_path);
+        return 0;
+    }
+    char record[2048];
+    int len = snprintf(record, sizeof(record), "%s|%s|%s\n", op, a ? a : "", b ? b : "");
+    if (len >= (int)sizeof(record)) len = sizeof(record) - 1;
+    int ok = write(fd, record, len) == len && fdatasync(fd) == 0;
+    close(fd);
+    if (!ok) printf("Error: Failed to write config journal: %s\n", store->journal_path);
+    return ok;
+}
+// Option lines ("engine:...", "bus:...") reuse the keybind column for values
+static int is_option(const char *id) {
+    return strchr(id, ':') != NULL;
+}
+// Global commands (stop, bank switching) are not tied to a bank
+static int is_global(const char *id) {
+    return !isdigit((unsigned char)id[0]) && !is_option(id);
+}
+static int is_global_command(const char *id) {
+    return strcmp(id, "stop") == 0 || strcmp(id, "bank_next") == 0 || strcmp(id, "bank_prev") == 0;
+}
+static const char *global_description(const char *id) {
+    if (strcmp(id, "bank_next") == 0) return "Next Sound Bank";
+    if (strcmp(id, "bank_prev") == 0) return "Previous Sound Bank";
+    return "Stop All Sounds";
+}
+// Two binds collide if they use the same key in the same bank, or one of them is global
+static int keybinds_conflict(const char *id_a, const char *a, const char *id_b, const char *b) {
+    const char *key_a, *key_b;
+    int bank_a = config_keybind_bank(a, &key_a);
+    int bank_b = config_keybind_bank(b, &key_b);
+    if (!key_a[0] || strcmp(key_a, key_b) != 0) return 0;
+    return bank_a == bank_b || is_global(id_a) || is_global(id_b);
+}
+static void add_id(char ***ids, const char *id) {
+    int count = 0;
+    while (*ids && (*ids)[count]) count++;
+    char **grown = realloc(*ids, (count + 2) * sizeof(char *));
+    if (!grown) return;
+    grown[count] = xstrdup(id);
+    grown[count + 1] = NULL;
+    *ids = grown;
+}
+static int apply_bind(ConfigStore *store, const char *id, const char *keybind, char ***cleared_ids) {
+    ConfigEntry *target = config_store_find(store, id);
+    if (!target && !is_global_command(id)) {
+        return 0;
+    }
+    if ((target && is_option(id)) || (is_global(id) && strchr(keybind, ':'))) {
+        return 0;
+    }
+    for (int i = 0; i < store->count; i++) {
+        ConfigEntry *entry = &store->entries[i];
+        if (entry->id && entry != target && !is_option(entry->id) &&
+            keybinds_conflict(id, keybind, entry->id, entry->keybind)) {
+            if (cleared_ids) add_id(cleared_ids, entry->id);
+            free(entry->keybind);
+            entry->keybind = xstrdup("");
+        }
+    }
+    if (!target) {
+        target = append_entry(store);
+        if (!target) return 0;
+        target->id = xstrdup(id);
+        target->filename = xstrdup("");
+        target->keybind = xstrdup("");
+        target->description = xstrdup(global_description(id));
+    }
+    free(target->keybind);
+    target->keybind = xstrdup(keybind);
+    store->dirty = 1;
+    return 1;
+}
+static int apply_unbind(ConfigStore *store, const char *id) {
+    ConfigEntry *entry = config_store_find(store, id);
+    if (!entry) return 0;
+    free(entry->keybind);
+    entry->keybind = xstrdup("");
+    store->dirty = 1;
+    return 1;
+}
+static int apply_description(ConfigStore *store, const char *id, const char *description) {
+    ConfigEntry *entry = config_store_find(store, id);
+    if (!entry) return 0;
+    free(entry->description);
+    entry->description = sanitize_field(description);
+    store->dirty = 1;
+    return 1;
+}
+// Sound IDs are plain numbers; anything else is a global command or an option
+static int is_sound_id(const char *id) {
+    if (!id[0]) return 0;
+    for (const char *p = id; *p; p++) {
+        if (!isdigit((unsigned char)*p)) return 0;
+    }
+    return 1;
+}
+// Per-sound option lines ("gain:5", "retrigger:5") follow their sound to a new ID
+static const char *sound_option_kinds[] = {"gain", "retrigger"};
+static void rename_sound_options(ConfigStore *store, const char *old_id, const char *new_id) {
+    for (size_t k = 0; k < sizeof(sound_option_kinds) / sizeof(sound_option_kinds[0]); k++) {
+        char old_name[256], new_name[256];
+        snprintf(old_name, sizeof(old_name), "%s:%s", sound_option_kinds[k], old_id);
+        snprintf(new_name, sizeof(new_name), "%s:%s", sound_option_kinds[k], new_id);
+        ConfigEntry *option = config_store_find(store, old_name);
+        if (!option) continue;
+        ConfigEntry *stale = config_store_find(store, new_name);
+        if (stale) {
+            // Left behind by a sound that no longer exists; keep its place as a blank line
+            free_entry(stale);
+            stale->raw = xstrdup("");
+        }
+        free(option->id);
+        option->id = xstrdup(new_name);
+    }
+}
+static int apply_id(ConfigStore *store, const char *old_id, const char *new_id) {
+    ConfigEntry *entry = config_store_find(store, old_id);
+    if (!entry || !is_sound_id(old_id) || !is_sound_id(new_id) || config_store_find(store, new_id)) {
+        return 0;
+    }
+    rename_sound_options(store, old_id, new_id);
+    free(entry->id);
+    entry->id = xstrdup(new_id);
+    store->dirty = 1;
+    return 1;
+}
+// Re-apply changes that were journaled but never made it into config.txt.
+// Every operation is idempotent, so replaying a journal that was already saved is harmless.
+static int replay_journal(ConfigStore *store) {
+    FILE *file = fopen(store->journal_path, "r");
+    if (!file) return 0;
+    char line[2048];
+    int replayed = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *a = strchr(line, '|');
+        if (!a) continue;
+        *a++ = '\0';
+        char *b = strchr(a, '|');
+        if (!b) continue;
+        *b++ = '\0';
+        if (strcmp(line, "bind") == 0) {
+            replayed += apply_bind(store, a, b, NULL);
+        } else if (strcmp(line, "unbind") == 0) {
+            replayed += apply_unbind(store, a);
+        } else if (strcmp(line, "desc") == 0) {
+            replayed += apply_description(store, a, b);
+        } else if (strcmp(line, "id") == 0) {
+            replayed += apply_id(store, a, b);
+        }
+    }
+    fclose(file);
+    return replayed;
+}
+// Serialise whole edits between processes; a store is short-lived, so just wait
+static int lock_config(const char *path) {
+    size_t lock_len = strlen(path) + sizeof(".lock");
+    char *lock_path = malloc(lock_len);
+    if (!lock_path) return -1;
+    snprintf(lock_path, lock_len, "%s.lock", path);
+    int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    free(lock_path);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+int config_store_load(ConfigStore *store, const char *path) {
+    memset(store, 0, sizeof(*store));
+    store->lock_fd = lock_config(path);
+    store->path = xstrdup(path);
+    size_t journal_len = strlen(path) + sizeof(".journal");
+    store->journal_path = malloc(journal_len);
+    if (!store->journal_path) {
+        config_store_free(store);
+        return 0;
+    }
+    snprintf(store->journal_path, journal_len, "%s.journal", path);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        printf("Error: Could not open config file: %s\n", path);
+        config_store_free(store);
+        return 0;
+    }
+    char line[2048];
+    while (fgets(line, sizeof(line), file)) {
+        if (!parse_line(store, line)) {
+            fclose(file);
+            config_store_free(store);
+            return 0;
+        }
+    }
+    fclose(file);
+    if (replay_journal(store) > 0) {
+        printf("Recovered unsaved config changes from %s\n", store->journal_path);
+        config_store_save(store);
+    }
+    store->dirty = 0;
+    return 1;
+}
+void config_store_free(ConfigStore *store) {
+    for (int i = 0; i < store->count; i++) {
+        free_entry(&store->entries[i]);
+    }
+    free(store->entries);
+    free(store->path);
+    free(store->journal_path);
+    if (store->lock_fd >= 0) close(store->lock_fd);
+    memset(store, 0, sizeof(*store));
+    store->lock_fd = -1;
+}
+ConfigEntry *config_store_find(ConfigStore *store, const char *id) {
+    for (int i = 0; i < store->count; i++) {
+        if (store->entries[i].id && strcmp(store->entries[i].id, id) == 0) {
+            return &store->entries[i];
+        }
+    }
+    return NULL;
+}
+ConfigEntry *config_store_find_keybind(ConfigStore *store, const char *keybind) {
+    for (int i = 0; i < store->count; i++) {
+        ConfigEntry *entry = &store->entries[i];
+        if (entry->id && !is_option(entry->id) && keybind[0] && strcmp(entry->keybind, keybind) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+const char *config_store_option(ConfigStore *store, const char *name, const char *fallback) {
+    ConfigEntry *entry = config_store_find(store, name);
+    if (!entry || !entry->filename[0]) {
+        return fallback;
+    }
+    return entry->filename;
+}
+int config_keybind_bank(const char *keybind, const char **key) {
+    const char *colon = strchr(keybind, ':');
+    if (!colon || colon == keybind || !isdigit((unsigned char)keybind[0])) {
+        *key = keybind;
+        return 1;
+    }
+    long bank = strtol(keybind, NULL, 10);
+    *key = colon + 1;
+    if (bank > CONFIG_MAX_BANKS) return 0;
+    return bank > 0 ? bank : 1;
+}
+// A keybind is one token in config.txt, the journal and ~/.xbindkeysrc:
+// no pipes, whitespace or control characters
+static int valid_keybind(const char *keybind) {
+    if (!keybind[0]) return 0;
+    for (const char *p = keybind; *p; p++) {
+        if (*p == '|' || isspace((unsigned char)*p) || iscntrl((unsigned char)*p)) return 0;
+    }
+    return 1;
+}
+int config_store_bind(ConfigStore *store, const char *id, const char *keybind, char ***cleared_ids) {
+    if (cleared_ids) *cleared_ids = NULL;
+    if (!config_store_find(store, id) && !is_global_command(id)) {
+        return CONFIG_NOT_FOUND;
+    }
+    const char *key;
+    if (!valid_keybind(keybind)) {
+        printf("Error: Invalid keybind '%s'\n", keybind);
+        return CONFIG_INVALID;
+    }
+    if (is_option(id)) {
+        printf("Error: %s is a setting, not a sound\n", id);
+        return CONFIG_INVALID;
+    }
+    if (is_global(id) && strchr(keybind, ':')) {
+        printf("Error: %s works in every bank, bind it without a bank prefix\n", id);
+        return CONFIG_INVALID;
+    }
+    if (!config_keybind_bank(keybind, &key)) {
+        printf("Error: Bank numbers go up to %d\n", CONFIG_MAX_BANKS);
+        return CONFIG_INVALID;
+    }
+    if (!apply_bind(store, id, keybind, cleared_ids)) {
+        return CONFIG_INVALID;
+    }
+    return journal_append(store, "bind", id, keybind) ? CONFIG_OK : CONFIG_JOURNAL_FAILED;
+}
+void config_store_free_ids(char **ids) {
+    for (int i = 0; ids && ids[i]; i++) {
+        free(ids[i]);
+    }
+    free(ids);
+}
+int config_store_unbind(ConfigStore *store, const char *id) {
+    if (!apply_unbind(store, id)) return CONFIG_NOT_FOUND;
+    return journal_append(store, "unbind", id, NULL) ? CONFIG_OK : CONFIG_JOURNAL_FAILED;
+}
+int config_store_set_description(ConfigStore *store, const char *id, const char *description) {
+    if (!apply_description(store, id, description)) return CONFIG_NOT_FOUND;
+    return journal_append(store, "desc", id, config_store_find(store, id)->description)
+           ? CONFIG_OK : CONFIG_JOURNAL_FAILED;
+}
+int config_store_set_id(ConfigStore *store, const char *old_id, const char *new_id) {
+    if (!config_store_find(store, old_id)) return CONFIG_NOT_FOUND;
+    if (!apply_id(store, old_id, new_id)) return CONFIG_INVALID;
+    return journal_append(store, "id", old_id, new_id) ? CONFIG_OK : CONFIG_JOURNAL_FAILED;
+}
+// Write a whole file next to its destination, fsync it and rename it into place
+// A unique temp name, so concurrent writers never truncate each other's file
+static int write_atomically(const char *path, int (*emit)(FILE *, void *), void *ctx) {
+    size_t tmp_len = strlen(path) + sizeof(".XXXXXX");
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) return 0;
+    snprintf(tmp_path, tmp_len, "%s.XXXXXX", path);
+    int fd = mkstemp(tmp_path);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!file) {
+        printf("Error: Could not write %s\n", tmp_path);
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp_path);
+        }
+        free(tmp_path);
+        return 0;
+    }
+    // mkstemp creates the file 0600; give it the mode a plain fopen would
+    mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask);
+    int ok = emit(file, ctx);
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = (fclose(file) == 0) && ok;
+    if (ok && rename(tmp_path, path) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        printf("Error: Failed to save %s\n", path);
+        unlink(tmp_path);
+        free(tmp_path);
+        return 0;
+    }
+    free(tmp_path);
+    // Make the rename itself durable
+    char *dir_copy = xstrdup(path);
+    int dir_fd = open(dirname(dir_copy), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    free(dir_copy);
+    return 1;
+}
+static int emit_config(FILE *file, void *ctx) {
+    ConfigStore *store = ctx;
+    for (int i = 0; i < store->count; i++) {
+        ConfigEntry *entry = &store->entries[i];
+        if (entry->id) {
+            fprintf(file, "%s|%s|%s|%s\n", entry->id, entry->filename, entry->keybind, entry->description);
+        } else {
+            fprintf(file, "%s\n", entry->raw);
+        }
+    }
+    return !ferror(file);
+}
+int config_store_save(ConfigStore *store) {
+    if (!write_atomically(store->path, emit_config, store)) {
+        return 0;
+    }
+    unlink(store->journal_path);
+    store->dirty = 0;
+    return 1;
+}
+typedef struct {
+    ConfigStore *store;
+    const char *sound_dir;
+    const char *script_path;
+    const char *engine_path;
+} XbindkeysContext;
+static int sound_file_exists(XbindkeysContext *x, ConfigEntry *entry) {
+    char sound_path[4096];
+    struct stat st;
+    snprintf(sound_path, sizeof(sound_path), "%s/%s", x->sound_dir, entry->filename);
+    return stat(sound_path, &st) == 0 && S_ISREG(st.st_mode);
+}
+// One press and one release line per physical key; soundboardd looks the key up
+// in the active bank and uses the releases to drop X auto-repeat presses.
+// The client starts the daemon if it is not running (exit status 2 if it cannot),
+// then the key's bank 1 sound is played through the script.
+typedef struct {
+    const char *key;
+    ConfigEntry *fallback;   // bank 1 sound on this key, if any
+} EngineKey;
+static int emit_engine_keys(FILE *file, XbindkeysContext *x) {
+    // One pass: each sound file is checked once and keys are collected in first-seen order
+    EngineKey *keys = malloc((x->store->count ? x->store->count : 1) * sizeof(EngineKey));
+    if (!keys) return 0;
+    int key_count = 0;
+    for (int i = 0; i < x->store->count; i++) {
+        ConfigEntry *entry = &x->store->entries[i];
+        if (!entry->id || !entry->keybind[0] || !isdigit((unsigned char)entry->id[0]) ||
+            !sound_file_exists(x, entry)) {
+            continue;
+        }
+        const char *key;
+        int bank = config_keybind_bank(entry->keybind, &key);
+        int k = 0;
+        while (k < key_count && strcmp(keys[k].key, key) != 0) k++;
+        if (k == key_count) {
+            keys[key_count].key = key;
+            keys[key_count++].fallback = NULL;
+        }
+        if (bank == 1 && !keys[k].fallback) keys[k].fallback = entry;
+    }
+    for (int k = 0; k < key_count; k++) {
+        fprintf(file, "# Key %s (sound depends on the active bank)\n\"%s -c %s key %s", keys[k].key,
+                x->engine_path, x->store->path, keys[k].key);
+        if (keys[k].fallback) {
+            fprintf(file, " || test $? -ne 2 || %s %s both", x->script_path, keys[k].fallback->id);
+        }
+        fprintf(file, "\"\n    %s\n", keys[k].key);
+        fprintf(file, "\"%s release %s\"\n    Release + %s\n\n", x->engine_path, keys[k].key, keys[k].key);
+    }
+    free(keys);
+    return 1;
+}
+static int emit_xbindkeys(FILE *file, void *ctx) {
+    XbindkeysContext *x = ctx;
+    fprintf(file, "# Soundboard xbindkeys configuration - AUTO GENERATED\n");
+    fprintf(file, "# This file is automatically managed by soundboard.sh\n");
+    fprintf(file, "# Manual changes will be overwritten!\n\n");
+    fprintf(file, "# Soundboard keybinds:\n");
+    if (x->engine_path) {
+        if (!emit_engine_keys(file, x)) return 0;
+    } else {
+        for (int i = 0; i < x->store->count; i++) {
+            ConfigEntry *entry = &x->store->entries[i];
+            const char *key;
+            if (!entry->id || !entry->keybind[0] || !isdigit((unsigned char)entry->id[0]) ||
+                config_keybind_bank(entry->keybind, &key) != 1 || !sound_file_exists(x, entry)) {
+                continue;
+            }
+            fprintf(file, "# %s\n\"%s %s both\"\n    %s\n\n",
+                    entry->description, x->script_path, entry->id, key);
+        }
+    }
+    ConfigEntry *stop = config_store_find(x->store, "stop");
+    if (stop && stop->keybind[0] && x->engine_path) {
+        fprintf(file, "# Stop All Sounds\n\"%s stop || test $? -ne 2 || %s stop\"\n    %s\n\n",
+                x->engine_path, x->script_path, stop->keybind);
+    } else if (stop && stop->keybind[0]) {
+        fprintf(file, "# Stop All Sounds\n\"%s stop\"\n    %s\n\n", x->script_path, stop->keybind);
+    }
+    // Bank switching only works with the engine holding the key tables
+    static const char *bank_commands[][2] = {{"bank_next", "next"}, {"bank_prev", "prev"}};
+    for (int i = 0; x->engine_path && i < 2; i++) {
+        ConfigEntry *entry = config_store_find(x->store, bank_commands[i][0]);
+        if (entry && entry->keybind[0]) {
+            fprintf(file, "# %s\n\"%s -c %s bank %s\"\n    %s\n\n",
+                    entry->description, x->engine_path, x->store->path, bank_commands[i][1], entry->keybind);
+        }
+    }
+    return !ferror(file);
+}
+int config_store_write_xbindkeys(ConfigStore *store, const char *sound_dir,
+                                 const char *script_path, const char *engine_path,
+                                 const char *out_path) {
+    XbindkeysContext ctx = {store, sound_dir, script_path, engine_path};
+    return write_atomically(out_path, emit_xbindkeys, &ctx);
+}
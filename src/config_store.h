@@ -0,0 +1,64 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+// In-memory view of ~/soundboard/config.txt shared by the GUI and soundboardcfg.
+// Lines keep the "ID|filename|keybind|description" format; comments and blank
+// lines are carried through untouched. Every change is appended to a small
+// journal next to the config so a crash between edit and save can be replayed,
+// and config_store_save() replaces the file with a single write + rename.
+// A loaded store holds an exclusive lock on "<config>.lock" until it is freed,
+// so the GUI, soundboardcfg and the engine never interleave load/edit/save.
+//
+// Keybinds may carry a bank prefix: "KP_1" is bank 1, "2:KP_1" is KP_1 in bank 2.
+// Non-numeric IDs ("stop", "bank_next", "bank_prev") are global and own their key
+// in every bank. Engine settings use "<kind>:<name>|<value>||<description>" lines,
+// e.g. "engine:bank_budget_mb|256||Decoded audio kept in memory".
+#define CONFIG_MAX_BANKS 32
+typedef struct {
+    char *id;          // sound ID, global command or option name; NULL for comment/blank lines
+    char *filename;
+    char *keybind;     // empty string when unbound
+    char *description;
+    char *raw;         // verbatim text of comment/blank lines
+} ConfigEntry;
+
+typedef struct {
+    char *path;
+    char *journal_path;
+    ConfigEntry *entries;
+    int count;
+    int capacity;
+    int dirty;
+    int lock_fd;       // -1 if the lock file could not be created
+} ConfigStore;
+
+// Load config (and replay any pending journal). Returns 1 on success, 0 on failure.
+int config_store_load(ConfigStore *store, const char *path);
+void config_store_free(ConfigStore *store);
+ConfigEntry *config_store_find(ConfigStore *store, const char *id);
+ConfigEntry *config_store_find_keybind(ConfigStore *store, const char *keybind);
+// Value column of an "<kind>:<name>" option line, or fallback if it is missing
+const char *config_store_option(ConfigStore *store, const char *name, const char *fallback);
+// Split "N:KEY" into bank N and KEY; plain keys are bank 1.
+// Returns 0 for a bank number above CONFIG_MAX_BANKS.
+int config_keybind_bank(const char *keybind, const char **key);
+// Mutation results
+#define CONFIG_OK 1
+#define CONFIG_NOT_FOUND 0        // no entry with that ID
+#define CONFIG_INVALID -1         // the change is not allowed (bad keybind, ID in use, ...)
+#define CONFIG_JOURNAL_FAILED -2  // could not be journaled (already reported); do not save
+// Mutations return a CONFIG_ result. For bind, *cleared_ids (if non-NULL) receives
+// a NULL-terminated list of the IDs that lost their key, or NULL if none did.
+int config_store_bind(ConfigStore *store, const char *id, const char *keybind, char ***cleared_ids);
+void config_store_free_ids(char **ids);
+int config_store_unbind(ConfigStore *store, const char *id);
+int config_store_set_description(ConfigStore *store, const char *id, const char *description);
+int config_store_set_id(ConfigStore *store, const char *old_id, const char *new_id);
+// Atomically write config.txt and clear the journal
+int config_store_save(ConfigStore *store);
+// Generate an xbindkeys rc file for all bound sounds that exist in sound_dir.
+// With engine_path set, every key is routed through soundboardd so bank switches
+// never touch the rc file; without it only bank 1 is exported (one line per sound).
+int config_store_write_xbindkeys(ConfigStore *store, const char *sound_dir,
+                                 const char *script_path, const char *engine_path,
+                                 const char *out_path);
+#endif
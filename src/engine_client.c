@@ -0,0 +1,68 @@
+#include "engine_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+void engine_socket_path(char *path, size_t size) {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && runtime_dir[0]) {
+        snprintf(path, size, "%s/soundboard.sock", runtime_dir);
+    } else {
+        snprintf(path, size, "/tmp/soundboard-%d.sock", (int)getuid());
+    }
+}
+int engine_request_start(const char *command) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    // Autobind to an abstract address so the daemon can answer us
+    struct sockaddr_un local = {.sun_family = AF_UNIX};
+    if (bind(fd, (struct sockaddr *)&local, sizeof(sa_family_t)) != 0) {
+        close(fd);
+        return -1;
+    }
+    struct sockaddr_un daemon_addr = {.sun_family = AF_UNIX};
+    engine_socket_path(daemon_addr.sun_path, sizeof(daemon_addr.sun_path));
+    // ENOENT/ECONNREFUSED here mean no daemon; once sent, a missing reply only means a slow one
+    if (sendto(fd, command, strlen(command), 0,
+               (struct sockaddr *)&daemon_addr, sizeof(daemon_addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+static int receive_reply(int fd, int flags, char *reply, size_t reply_size) {
+    char buffer[ENGINE_COMMAND_MAX];
+    ssize_t len = recv(fd, buffer, sizeof(buffer) - 1, flags);
+    if (len < 0) return ENGINE_NO_REPLY;
+    buffer[len] = '\0';
+    // "<status> <text>"
+    char *text = buffer + strcspn(buffer, " ");
+    size_t status_len = text - buffer;
+    int result = status_len == strlen(ENGINE_REPLY_ERROR) && strncmp(buffer, ENGINE_REPLY_ERROR, status_len) == 0
+                 ? ENGINE_ERROR : ENGINE_OK;
+    if (*text) text++;
+    if (reply && reply_size > 0) {
+        snprintf(reply, reply_size, "%s", text);
+    }
+    return result;
+}
+int engine_request_finish(int fd, char *reply, size_t reply_size) {
+    return receive_reply(fd, MSG_DONTWAIT, reply, reply_size);
+}
+int engine_request(const char *command, char *reply, size_t reply_size) {
+    int fd = engine_request_start(command);
+    if (fd < 0) return ENGINE_DOWN;
+    struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int result = receive_reply(fd, 0, reply, reply_size);
+    close(fd);
+    return result;
+}
+int engine_send(const char *command, char *reply, size_t reply_size) {
+    int result = engine_request(command, reply, reply_size);
+    return result == ENGINE_OK || result == ENGINE_ERROR;
+}
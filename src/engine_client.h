@@ -0,0 +1,26 @@
+#ifndef ENGINE_CLIENT_H
+#define ENGINE_CLIENT_H
+#include <stddef.h>
+// Tiny datagram client for soundboardd. Commands are single text lines
+// ("key KP_1", "bank next", "play 5 both", "stop", ...) and every command
+// gets a one-line reply: a status word, a space and the text for the user.
+#define ENGINE_COMMAND_MAX 512
+#define ENGINE_REPLY_OK "ok"
+#define ENGINE_REPLY_ERROR "error"
+// Socket lives in $XDG_RUNTIME_DIR (falls back to /tmp/soundboard-<uid>.sock)
+void engine_socket_path(char *path, size_t size);
+// engine_request results
+#define ENGINE_OK 0
+#define ENGINE_DOWN 1        // no socket, or nobody listening on it
+#define ENGINE_NO_REPLY 2    // the command was delivered but no answer came in time
+#define ENGINE_ERROR 3       // the daemon answered that the command failed
+// Send a command and wait briefly for the reply text; returns an ENGINE_ result
+int engine_request(const char *command, char *reply, size_t reply_size);
+// Same, returns 1 if the daemon answered (whether or not the command worked)
+int engine_send(const char *command, char *reply, size_t reply_size);
+// For event loops: send a command and return the socket the reply will arrive
+// on (watch it for input), or -1 if no daemon is there. The caller closes it.
+int engine_request_start(const char *command);
+// Read the reply without blocking; ENGINE_NO_REPLY if it has not arrived yet
+int engine_request_finish(int fd, char *reply, size_t reply_size);
+#endif
@@ -0,0 +1,379 @@
+#include "mixer.h"
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <unistd.h>
+#include <pulse/error.h>
+
+static pa_simple *open_output(const char *sink, const char *stream_name) {
+    pa_sample_spec spec = {
+        .format = PA_SAMPLE_FLOAT32LE,
+        .rate = SAMPLE_RATE,
+        .channels = SAMPLE_CHANNELS
+    };
+    // Keep the server-side buffer short so a trigger is heard within a couple of periods
+    pa_buffer_attr attr = {
+        .maxlength = (uint32_t)-1,
+        .tlength = MIXER_PERIOD * 2 * SAMPLE_CHANNELS * sizeof(float),
+        .prebuf = (uint32_t)-1,
+        .minreq = (uint32_t)-1,
+        .fragsize = (uint32_t)-1
+    };
+    int error = 0;
+    pa_simple *stream = pa_simple_new(NULL, "Soundboard", PA_STREAM_PLAYBACK, sink, stream_name,
+                                      &spec, NULL, &attr, &error);
+    if (!stream) {
+        printf("Warning: Could not open sink %s: %s\n", sink, pa_strerror(error));
+    }
+    return stream;
+}
+static float block_level(const Voice *voice) {
+    float peak = 0.0f, gain = 0.0f;
+    for (size_t i = 0; i < voice->block_frames * SAMPLE_CHANNELS; i++) {
+        float value = voice->buffer[i] < 0 ? -voice->buffer[i] : voice->buffer[i];
+        if (value > peak) peak = value;
+    }
+    for (int b = 0; b < ROUTING_MAX_BUSES; b++) {
+        if (voice->gains[b] > gain) gain = voice->gains[b];
+    }
+    return peak * gain;
+}
+// Mix up to one period of a voice into every bus it has a gain on,
+// decoding codec blocks as it crosses them
+static void mix_voice(Voice *voice, float (*buses)[MIXER_PERIOD * SAMPLE_CHANNELS], int bus_count) {
+    size_t done = 0;
+    while (done < MIXER_PERIOD && voice->position < voice->sample->frames) {
+        size_t block = voice->position / SAMPLE_CODEC_BLOCK;
+        size_t offset = voice->position % SAMPLE_CODEC_BLOCK;
+        if (block != voice->block) {
+            voice->block_frames = sample_codec_decode_block(&voice->sample->audio, block, voice->buffer);
+            voice->block = block;
+            voice->level = block_level(voice);
+        }
+        size_t frames = voice->block_frames - offset;
+        if (frames > MIXER_PERIOD - done) frames = MIXER_PERIOD - done;
+        const float *in = voice->buffer + offset * SAMPLE_CHANNELS;
+        for (int b = 0; b < bus_count; b++) {
+            float gain = voice->gains[b];
+            if (gain == 0.0f) continue;
+            float *out = buses[b] + done * SAMPLE_CHANNELS;
+            for (size_t i = 0; i < frames * SAMPLE_CHANNELS; i++) out[i] += gain * in[i];
+        }
+        done += frames;
+        voice->position += frames;
+    }
+}
+static void clip(float *buffer, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        if (buffer[i] > 1.0f) buffer[i] = 1.0f;
+        else if (buffer[i] < -1.0f) buffer[i] = -1.0f;
+    }
+}
+static void open_streams(const Routing *routing, pa_simple **streams) {
+    for (int b = 0; b < routing->bus_count; b++) {
+        char stream_name[64];
+        snprintf(stream_name, sizeof(stream_name), "Soundboard %s", routing->buses[b].name);
+        streams[b] = open_output(routing->buses[b].sink, stream_name);
+    }
+}
+static void close_streams(pa_simple **streams, int count) {
+    for (int b = 0; b < count; b++) {
+        if (streams[b]) pa_simple_free(streams[b]);
+        streams[b] = NULL;
+    }
+}
+// Runs on the mixer thread so no stream is ever freed in the middle of a write
+static void apply_pending_buses(Mixer *mixer) {
+    pa_simple *old[ROUTING_MAX_BUSES];
+    pthread_mutex_lock(&mixer->lock);
+    int old_count = mixer->routing.bus_count;
+    memcpy(old, mixer->streams, sizeof(old));
+    memset(mixer->streams, 0, sizeof(mixer->streams));
+    mixer->routing = mixer->pending;
+    Routing routing = mixer->pending;
+    mixer->reconfigure = 0;
+    int suspended = mixer->suspended;
+    pthread_mutex_unlock(&mixer->lock);
+    close_streams(old, old_count);
+    if (suspended) return;  // opened on resume
+    pa_simple *streams[ROUTING_MAX_BUSES] = {0};
+    open_streams(&routing, streams);
+    pthread_mutex_lock(&mixer->lock);
+    if (mixer->reconfigure) {
+        close_streams(streams, routing.bus_count);  // superseded while we were opening
+    } else {
+        memcpy(mixer->streams, streams, sizeof(streams));
+    }
+    pthread_mutex_unlock(&mixer->lock);
+}
+// Open the buses whose stream is missing, e.g. after the server came back
+static void reopen_missing(Mixer *mixer) {
+    pa_simple *streams[ROUTING_MAX_BUSES] = {0};
+    pthread_mutex_lock(&mixer->lock);
+    Routing routing = mixer->routing;
+    int missing[ROUTING_MAX_BUSES];
+    for (int b = 0; b < routing.bus_count; b++) missing[b] = mixer->streams[b] == NULL;
+    mixer->reopen = 0;
+    pthread_mutex_unlock(&mixer->lock);
+    for (int b = 0; b < routing.bus_count; b++) {
+        if (!missing[b]) continue;
+        char stream_name[64];
+        snprintf(stream_name, sizeof(stream_name), "Soundboard %s", routing.buses[b].name);
+        streams[b] = open_output(routing.buses[b].sink, stream_name);
+    }
+    pthread_mutex_lock(&mixer->lock);
+    for (int b = 0; b < routing.bus_count; b++) {
+        if (!streams[b]) continue;
+        if (mixer->reconfigure || mixer->streams[b]) {
+            pa_simple_free(streams[b]);
+        } else {
+            mixer->streams[b] = streams[b];
+        }
+    }
+    pthread_mutex_unlock(&mixer->lock);
+}
+// Suspended: drop every open stream
+static void close_all(Mixer *mixer) {
+    pa_simple *old[ROUTING_MAX_BUSES];
+    pthread_mutex_lock(&mixer->lock);
+    int count = mixer->routing.bus_count;
+    memcpy(old, mixer->streams, sizeof(old));
+    memset(mixer->streams, 0, sizeof(mixer->streams));
+    pthread_mutex_unlock(&mixer->lock);
+    close_streams(old, count);
+}
+static void remove_voice(Mixer *mixer, int index) {
+    mixer->voices[index] = mixer->voices[--mixer->voice_count];
+}
+static void *mixer_thread(void *data) {
+    Mixer *mixer = data;
+    static float buses[ROUTING_MAX_BUSES][MIXER_PERIOD * SAMPLE_CHANNELS];
+    Sample *finished[MIXER_MAX_VOICES];
+    pa_simple *streams[ROUTING_MAX_BUSES];
+    while (mixer->running) {
+        if (mixer->reconfigure) apply_pending_buses(mixer);
+        else if (mixer->suspended) close_all(mixer);
+        else if (mixer->reopen) reopen_missing(mixer);
+        int finished_count = 0;
+        pthread_mutex_lock(&mixer->lock);
+        int bus_count = mixer->routing.bus_count;
+        memcpy(streams, mixer->streams, sizeof(streams));
+        memset(buses, 0, bus_count * sizeof(buses[0]));
+        for (int i = 0; i < mixer->voice_count; i++) {
+            Voice *voice = &mixer->voices[i];
+            mix_voice(voice, buses, bus_count);
+            if (voice->position >= voice->sample->frames) {
+                finished[finished_count++] = voice->sample;
+                remove_voice(mixer, i--);
+            }
+        }
+        pthread_mutex_unlock(&mixer->lock);
+        for (int i = 0; i < finished_count; i++) {
+            sample_cache_release(mixer->cache, finished[i]);
+        }
+        // Blocking writes pace the loop to real time
+        int wrote = 0;
+        for (int b = 0; b < bus_count; b++) {
+            if (!streams[b]) continue;
+            clip(buses[b], MIXER_PERIOD * SAMPLE_CHANNELS);
+            int error = 0;
+            if (pa_simple_write(streams[b], buses[b], sizeof(buses[b]), &error) < 0) {
+                // Sink or server gone: drop the stream until the graph says it is back
+                printf("Warning: Write to %s failed: %s\n", mixer->routing.buses[b].sink, pa_strerror(error));
+                pthread_mutex_lock(&mixer->lock);
+                if (mixer->streams[b] == streams[b]) mixer->streams[b] = NULL;
+                pthread_mutex_unlock(&mixer->lock);
+                pa_simple_free(streams[b]);
+                continue;
+            }
+            wrote = 1;
+        }
+        if (!wrote) usleep(MIXER_PERIOD * 1000000 / SAMPLE_RATE);  // every sink is gone
+    }
+    return NULL;
+}
+int mixer_start(Mixer *mixer, SampleCache *cache, const Routing *routing) {
+    memset(mixer, 0, sizeof(*mixer));
+    mixer->cache = cache;
+    mixer->routing = *routing;
+    mixer->polyphony = MIXER_MAX_VOICES;
+    mixer->steal = STEAL_OLDEST;
+    pthread_mutex_init(&mixer->lock, NULL);
+    open_streams(routing, mixer->streams);
+    int opened = 0;
+    for (int b = 0; b < routing->bus_count; b++) {
+        if (mixer->streams[b]) opened++;
+    }
+    if (!opened) {
+        printf("Warning: No soundboard sinks yet, streams open once they appear\n");
+    }
+    mixer->running = 1;
+    if (pthread_create(&mixer->thread, NULL, mixer_thread, mixer) != 0) {
+        printf("Error: Failed to start mixer thread\n");
+        mixer->running = 0;
+        close_streams(mixer->streams, routing->bus_count);
+        return 0;
+    }
+    return 1;
+}
+void mixer_shutdown(Mixer *mixer) {
+    if (mixer->running) {
+        mixer->running = 0;
+        pthread_join(mixer->thread, NULL);
+    }
+    mixer_stop_all(mixer);
+    close_streams(mixer->streams, mixer->routing.bus_count);
+    pthread_mutex_destroy(&mixer->lock);
+}
+void mixer_set_buses(Mixer *mixer, const Routing *routing) {
+    // Voice gain rows are indexed by bus, so they cannot outlive the old layout
+    mixer_stop_all(mixer);
+    pthread_mutex_lock(&mixer->lock);
+    mixer->pending = *routing;
+    mixer->reconfigure = 1;
+    pthread_mutex_unlock(&mixer->lock);
+}
+void mixer_reopen(Mixer *mixer) {
+    pthread_mutex_lock(&mixer->lock);
+    mixer->reopen = 1;
+    pthread_mutex_unlock(&mixer->lock);
+}
+void mixer_suspend(Mixer *mixer, int suspended) {
+    pthread_mutex_lock(&mixer->lock);
+    mixer->suspended = suspended;
+    if (!suspended) mixer->reopen = 1;
+    pthread_mutex_unlock(&mixer->lock);
+    if (!suspended) return;
+    mixer_stop_all(mixer);
+    // Streams are only freed on the mixer thread, so wait for it to close them
+    for (;;) {
+        pthread_mutex_lock(&mixer->lock);
+        int open = 0;
+        for (int b = 0; b < ROUTING_MAX_BUSES; b++) {
+            if (mixer->streams[b]) open = 1;
+        }
+        pthread_mutex_unlock(&mixer->lock);
+        if (!open || !mixer->running) return;
+        usleep(MIXER_PERIOD * 1000000 / SAMPLE_RATE / 4);
+    }
+}
+int mixer_bus_ready(Mixer *mixer, int bus) {
+    pthread_mutex_lock(&mixer->lock);
+    int ready = !mixer->reconfigure && bus < mixer->routing.bus_count && mixer->streams[bus] != NULL;
+    pthread_mutex_unlock(&mixer->lock);
+    return ready;
+}
+void mixer_set_limits(Mixer *mixer, int polyphony, int steal) {
+    if (polyphony < 1 || polyphony > MIXER_MAX_VOICES) polyphony = MIXER_MAX_VOICES;
+    pthread_mutex_lock(&mixer->lock);
+    mixer->polyphony = polyphony;
+    mixer->steal = steal;
+    pthread_mutex_unlock(&mixer->lock);
+}
+// Voice to cut off for a new one. Voices that have not mixed a block yet
+// count as loud so a burst of triggers does not keep stealing each other.
+static int pick_victim(Mixer *mixer) {
+    int victim = 0;
+    for (int i = 1; i < mixer->voice_count; i++) {
+        Voice *voice = &mixer->voices[i], *best = &mixer->voices[victim];
+        if (mixer->steal == STEAL_QUIETEST) {
+            float level = voice->level < 0 ? FLT_MAX : voice->level;
+            float best_level = best->level < 0 ? FLT_MAX : best->level;
+            if (level < best_level || (level == best_level && voice->started < best->started)) victim = i;
+        } else if (voice->started < best->started) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+int mixer_play(Mixer *mixer, Sample *sample, const float *gains, int retrigger) {
+    if (!sample_cache_acquire(mixer->cache, sample)) {
+        return PLAY_FAILED;
+    }
+    // Pins to drop once the lock is released: cut-off voices, and ours if no voice keeps it
+    Sample *released[MIXER_MAX_VOICES + 1];
+    int released_count = 0;
+    int result = PLAY_STARTED;
+    Voice *voice = NULL;
+    pthread_mutex_lock(&mixer->lock);
+    if (mixer->suspended) {
+        pthread_mutex_unlock(&mixer->lock);
+        sample_cache_release(mixer->cache, sample);
+        return PLAY_SUSPENDED;
+    }
+    mixer->triggers++;
+    for (int i = 0; retrigger != RETRIGGER_OVERLAP && i < mixer->voice_count; i++) {
+        if (mixer->voices[i].sample != sample) continue;
+        if (retrigger == RETRIGGER_IGNORE) {
+            result = PLAY_IGNORED;
+            break;
+        }
+        if (retrigger == RETRIGGER_RESTART && !voice) {
+            voice = &mixer->voices[i];  // later copies are removed from behind it, so it stays put
+            result = PLAY_RESTARTED;
+            continue;
+        }
+        released[released_count++] = sample;
+        remove_voice(mixer, i--);
+        if (retrigger == RETRIGGER_TOGGLE) result = PLAY_STOPPED;
+    }
+    if (result == PLAY_STARTED) {
+        while (mixer->voice_count >= mixer->polyphony) {
+            int victim = pick_victim(mixer);
+            released[released_count++] = mixer->voices[victim].sample;
+            remove_voice(mixer, victim);
+            mixer->stolen++;
+            result = PLAY_STOLE;
+        }
+        voice = &mixer->voices[mixer->voice_count++];
+    } else {
+        released[released_count++] = sample;
+    }
+    if (voice) {
+        voice->sample = sample;
+        voice->position = 0;
+        memcpy(voice->gains, gains, sizeof(voice->gains));
+        voice->started = mixer->triggers;
+        voice->level = -1.0f;
+        voice->block = (size_t)-1;
+    }
+    if (result == PLAY_RESTARTED) mixer->restarted++;
+    if (result == PLAY_IGNORED) mixer->ignored++;
+    if (result == PLAY_STOPPED) mixer->toggled_off++;
+    pthread_mutex_unlock(&mixer->lock);
+    for (int i = 0; i < released_count; i++) {
+        sample_cache_release(mixer->cache, released[i]);
+    }
+    return result;
+}
+void mixer_stop_all(Mixer *mixer) {
+    Sample *stopped[MIXER_MAX_VOICES];
+    pthread_mutex_lock(&mixer->lock);
+    int count = mixer->voice_count;
+    for (int i = 0; i < count; i++) {
+        stopped[i] = mixer->voices[i].sample;
+    }
+    mixer->voice_count = 0;
+    pthread_mutex_unlock(&mixer->lock);
+    for (int i = 0; i < count; i++) {
+        sample_cache_release(mixer->cache, stopped[i]);
+    }
+}
+int mixer_voice_count(Mixer *mixer) {
+    pthread_mutex_lock(&mixer->lock);
+    int count = mixer->voice_count;
+    pthread_mutex_unlock(&mixer->lock);
+    return count;
+}
+int mixer_parse_retrigger(const char *name) {
+    if (strcmp(name, "overlap") == 0) return RETRIGGER_OVERLAP;
+    if (strcmp(name, "restart") == 0) return RETRIGGER_RESTART;
+    if (strcmp(name, "ignore") == 0) return RETRIGGER_IGNORE;
+    if (strcmp(name, "toggle") == 0) return RETRIGGER_TOGGLE;
+    return -1;
+}
+int mixer_parse_steal(const char *name) {
+    if (strcmp(name, "oldest") == 0) return STEAL_OLDEST;
+    if (strcmp(name, "quietest") == 0) return STEAL_QUIETEST;
+    return -1;
+}
@@ -0,0 +1,80 @@
+#ifndef MIXER_H
+#define MIXER_H
+#include <pthread.h>
+#include <pulse/simple.h>
+#include "sample_cache.h"
+#include "routing.h"
+// Software mixer: every playing sound is a voice that decodes its sample one
+// codec block at a time. Each period every voice is decoded once and added into
+// every bus it has a gain on, then all buses are written to their sinks.
+#define MIXER_PERIOD 512      // frames per write (~10 ms at 48 kHz)
+#define MIXER_MAX_VOICES 64
+// What a trigger does while the same sound is already playing
+#define RETRIGGER_OVERLAP 0   // start another voice
+#define RETRIGGER_RESTART 1   // rewind the playing voice
+#define RETRIGGER_IGNORE 2    // do nothing until it has finished
+#define RETRIGGER_TOGGLE 3    // stop it
+// Which voice gives way when the polyphony cap is reached
+#define STEAL_OLDEST 0
+#define STEAL_QUIETEST 1
+// mixer_play results
+#define PLAY_FAILED 0         // sample paged out
+#define PLAY_STARTED 1
+#define PLAY_STOLE 2          // started by cutting off another voice
+#define PLAY_RESTARTED 3
+#define PLAY_IGNORED 4
+#define PLAY_STOPPED 5
+#define PLAY_SUSPENDED 6      // the soundboard devices are torn down
+typedef struct {
+    Sample *sample;
+    size_t position;
+    float gains[ROUTING_MAX_BUSES];
+    unsigned long started;   // trigger serial, for oldest-voice stealing
+    float level;             // peak of the current block times the loudest gain, -1 before the first block
+    size_t block;            // codec block currently held in buffer
+    size_t block_frames;
+    float buffer[SAMPLE_CODEC_BLOCK * SAMPLE_CHANNELS];
+} Voice;
+typedef struct {
+    SampleCache *cache;
+    Routing routing;          // buses voice gains refer to
+    pa_simple *streams[ROUTING_MAX_BUSES];  // one per bus, NULL if its sink is missing
+    Routing pending;          // new bus layout for the mixer thread to open
+    int reconfigure;
+    int reopen;               // open the streams that are missing
+    int suspended;            // devices torn down: no streams, no new voices
+    Voice voices[MIXER_MAX_VOICES];
+    int voice_count;
+    int polyphony;            // voice cap, at most MIXER_MAX_VOICES
+    int steal;
+    unsigned long triggers;   // counters for status, guarded by lock
+    unsigned long stolen;
+    unsigned long restarted;
+    unsigned long ignored;
+    unsigned long toggled_off;
+    pthread_mutex_t lock;
+    pthread_t thread;
+    int running;
+} Mixer;
+
+int mixer_start(Mixer *mixer, SampleCache *cache, const Routing *routing);
+void mixer_shutdown(Mixer *mixer);
+// Switch to a new bus layout: stops all voices, the mixer thread reopens the sinks
+void mixer_set_buses(Mixer *mixer, const Routing *routing);
+// Retry the buses without a stream once their sinks exist again
+void mixer_reopen(Mixer *mixer);
+// Before the sinks are unloaded: stop every voice and close every stream, so the
+// server cannot move them to the hardware sink. Blocks until they are closed.
+// Resuming reopens the streams.
+void mixer_suspend(Mixer *mixer, int suspended);
+int mixer_bus_ready(Mixer *mixer, int bus);
+void mixer_set_limits(Mixer *mixer, int polyphony, int steal);
+// Trigger a resident sample with one gain per bus, applying the retrigger policy
+// if it is already playing and stealing a voice if the cap is reached. Returns a PLAY_ result.
+int mixer_play(Mixer *mixer, Sample *sample, const float *gains, int retrigger);
+void mixer_stop_all(Mixer *mixer);
+int mixer_voice_count(Mixer *mixer);
+// Policy names as used in config.txt; -1 if unknown
+int mixer_parse_retrigger(const char *name);
+int mixer_parse_steal(const char *name);
+#endif
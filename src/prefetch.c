@@ -0,0 +1,159 @@
+#include "prefetch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+void prefetch_init(Prefetch *prefetch) {
+    memset(prefetch, 0, sizeof(*prefetch));
+    pthread_mutex_init(&prefetch->lock, NULL);
+}
+static void unpin(PinnedFile *file) {
+    munlock(file->map, file->length);
+    munmap(file->map, file->length);
+    free(file->path);
+}
+void prefetch_destroy(Prefetch *prefetch) {
+    for (int i = 0; i < prefetch->pinned_count; i++) {
+        unpin(&prefetch->pinned[i]);
+    }
+    free(prefetch->pinned);
+    pthread_mutex_destroy(&prefetch->lock);
+}
+void prefetch_set_pin_budget(Prefetch *prefetch, size_t bytes) {
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->pin_budget = bytes;  // takes effect on the next pass
+    pthread_mutex_unlock(&prefetch->lock);
+}
+size_t prefetch_file(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+    // Asynchronous: the kernel queues the reads and we return right away
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+    return size;
+}
+// Map and lock a whole file; faults every page in, so this blocks on the disk
+static int pin(const char *path, PinnedFile *file, int *error) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *error = errno;
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        *error = errno;
+        close(fd);
+        return 0;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        *error = errno;
+        return 0;
+    }
+    if (mlock(map, st.st_size) != 0) {
+        *error = errno;
+        munmap(map, st.st_size);
+        return 0;
+    }
+    file->path = strdup(path);
+    file->map = map;
+    file->length = st.st_size;
+    return 1;
+}
+static PinnedFile *find_pinned(PinnedFile *files, int count, const char *path) {
+    for (int i = 0; i < count; i++) {
+        if (files[i].path && strcmp(files[i].path, path) == 0) return &files[i];
+    }
+    return NULL;
+}
+void prefetch_warm(Prefetch *prefetch, char **paths, int count, PrefetchYieldFn yield, void *data) {
+    pthread_mutex_lock(&prefetch->lock);
+    size_t pin_budget = prefetch->pin_budget;
+    pthread_mutex_unlock(&prefetch->lock);
+    size_t warm_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        warm_bytes += prefetch_file(paths[i]);
+    }
+    // Build the new pinned set, taking over files that are already pinned
+    PinnedFile *old = prefetch->pinned;
+    int old_count = prefetch->pinned_count;
+    PinnedFile *pinned = calloc(count ? count : 1, sizeof(PinnedFile));
+    if (!pinned) return;
+    int pinned_count = 0;
+    size_t pinned_bytes = 0;
+    for (int i = 0; i < count && pin_budget; i++) {
+        if (find_pinned(pinned, pinned_count, paths[i])) continue;
+        PinnedFile *kept = find_pinned(old, old_count, paths[i]);
+        if (kept) {
+            if (pinned_bytes + kept->length > pin_budget) continue;
+            pinned[pinned_count++] = *kept;
+            pinned_bytes += kept->length;
+            kept->path = NULL;
+            continue;
+        }
+        struct stat st;
+        if (stat(paths[i], &st) != 0 || pinned_bytes + st.st_size > pin_budget) continue;
+        int error = 0;
+        if (pin(paths[i], &pinned[pinned_count], &error)) {
+            pinned_bytes += pinned[pinned_count++].length;
+            if (yield) yield(data);  // pinning waits on the disk, so do not hold up others for the whole set
+        } else if (error == ENOMEM || error == EPERM || error == EAGAIN) {
+            if (!prefetch->pin_warned) {
+                printf("Warning: Could not pin sound files in memory (%s). Raise the memlock limit "
+                       "(ulimit -l) or lower engine:pin_mb; using readahead only.\n", strerror(error));
+                prefetch->pin_warned = 1;
+            }
+            break;
+        }
+    }
+    for (int i = 0; i < old_count; i++) {
+        if (old[i].path) unpin(&old[i]);
+    }
+    free(old);
+    prefetch->pinned = pinned;
+    prefetch->pinned_count = pinned_count;
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->pinned_bytes = pinned_bytes;
+    prefetch->passes++;
+    prefetch->warm_files = count;
+    prefetch->warm_bytes = warm_bytes;
+    pthread_mutex_unlock(&prefetch->lock);
+}
+int prefetch_is_cached(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    // Mapping without touching it does not read anything; mincore reports what is cached
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pages = (st.st_size + page - 1) / page;
+    unsigned char *resident = malloc(pages);
+    int cached = resident && mincore(map, st.st_size, resident) == 0;
+    for (size_t i = 0; cached && i < pages; i++) {
+        if (!(resident[i] & 1)) cached = 0;
+    }
+    free(resident);
+    munmap(map, st.st_size);
+    return cached;
+}
+void prefetch_note_trigger(Prefetch *prefetch, const char *path) {
+    int cached = prefetch_is_cached(path);
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->disk_triggers++;
+    if (!cached) prefetch->cold_triggers++;
+    pthread_mutex_unlock(&prefetch->lock);
+}
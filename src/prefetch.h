@@ -0,0 +1,42 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+#include <stddef.h>
+#include <pthread.h>
+// Page-cache warming for sound files that may have to be read at trigger time.
+// Every file in the warm set gets a readahead hint; within the pin budget the
+// files are also mapped and mlock'd so memory pressure cannot evict them again.
+typedef struct {
+    char *path;
+    void *map;
+    size_t length;
+} PinnedFile;
+typedef struct {
+    PinnedFile *pinned;      // only touched by the thread that calls prefetch_warm
+    int pinned_count;
+    int pin_warned;
+    pthread_mutex_t lock;    // guards the budget and the counters below
+    size_t pin_budget;       // 0 = readahead only
+    size_t pinned_bytes;
+    unsigned long passes;
+    unsigned long warm_files;     // files in the last pass
+    size_t warm_bytes;
+    unsigned long disk_triggers;  // triggers that had to read their sound file
+    unsigned long cold_triggers;  // ... and found part of it outside the page cache
+} Prefetch;
+
+void prefetch_init(Prefetch *prefetch);
+void prefetch_destroy(Prefetch *prefetch);
+void prefetch_set_pin_budget(Prefetch *prefetch, size_t bytes);
+// Called between the files of a pinning pass so the caller can serve urgent work
+typedef void (*PrefetchYieldFn)(void *data);
+// Warm a set of files, most important first: readahead for all of them, pins in
+// order while they fit the budget. Files pinned by an earlier pass but no longer
+// in the set are unpinned. yield (may be NULL) runs after every file pinned.
+void prefetch_warm(Prefetch *prefetch, char **paths, int count, PrefetchYieldFn yield, void *data);
+// Ask the kernel to read one file into the page cache in the background; returns its size
+size_t prefetch_file(const char *path);
+// 1 if every page of the file is in the page cache
+int prefetch_is_cached(const char *path);
+// Record a trigger that is about to read path from disk
+void prefetch_note_trigger(Prefetch *prefetch, const char *path);
+#endif
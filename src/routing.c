@@ -0,0 +1,97 @@
+#include "routing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void add_bus(Routing *routing, const char *name, const char *sink, float gain) {
+    Bus *bus = &routing->buses[routing->bus_count++];
+    snprintf(bus->name, sizeof(bus->name), "%s", name);
+    snprintf(bus->sink, sizeof(bus->sink), "%s", sink);
+    bus->default_gain = gain;
+}
+void routing_load(Routing *routing, ConfigStore *store) {
+    memset(routing, 0, sizeof(*routing));
+    for (int i = 0; i < store->count; i++) {
+        ConfigEntry *entry = &store->entries[i];
+        if (!entry->id || strncmp(entry->id, "bus:", 4) != 0) continue;
+        const char *name = entry->id + 4;
+        if (!name[0] || !entry->filename[0]) {
+            printf("Warning: Ignoring bus line without a name or sink: %s\n", entry->id);
+            continue;
+        }
+        if (routing_find_bus(routing, name) >= 0) {
+            printf("Warning: Bus %s is defined twice, using the first one\n", name);
+            continue;
+        }
+        if (routing->bus_count == ROUTING_MAX_BUSES) {
+            printf("Warning: Only %d buses are supported, ignoring %s\n", ROUTING_MAX_BUSES, name);
+            continue;
+        }
+        add_bus(routing, name, entry->filename, entry->keybind[0] ? (float)atof(entry->keybind) : 1.0f);
+    }
+    if (routing->bus_count == 0) {
+        add_bus(routing, "monitor", "soundboard_local", 1.0f);
+        add_bus(routing, "mic", "soundboard_output", 1.0f);
+    }
+}
+int routing_same_buses(const Routing *a, const Routing *b) {
+    if (a->bus_count != b->bus_count) return 0;
+    for (int i = 0; i < a->bus_count; i++) {
+        if (strcmp(a->buses[i].name, b->buses[i].name) != 0 ||
+            strcmp(a->buses[i].sink, b->buses[i].sink) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+int routing_find_bus(const Routing *routing, const char *name) {
+    for (int i = 0; i < routing->bus_count; i++) {
+        if (strcmp(routing->buses[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+// Apply "bus=gain,bus=gain" (a bare bus name means gain 1) on top of gains
+static int apply_gain_list(const Routing *routing, const char *list, float *gains) {
+    char copy[512];
+    snprintf(copy, sizeof(copy), "%s", list);
+    char *save = NULL;
+    for (char *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *equals = strchr(item, '=');
+        if (equals) *equals = '\0';
+        int bus = routing_find_bus(routing, item);
+        if (bus < 0) return 0;
+        gains[bus] = equals ? (float)atof(equals + 1) : 1.0f;
+    }
+    return 1;
+}
+void routing_sound_gains(const Routing *routing, ConfigStore *store, const char *id, float *gains) {
+    for (int b = 0; b < ROUTING_MAX_BUSES; b++) {
+        gains[b] = b < routing->bus_count ? routing->buses[b].default_gain : 0.0f;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "gain:%s", id);
+    const char *list = config_store_option(store, name, NULL);
+    if (list && !apply_gain_list(routing, list, gains)) {
+        printf("Warning: %s names an unknown bus: %s\n", name, list);
+    }
+}
+int routing_parse_mode(const Routing *routing, const char *mode, float *gains) {
+    for (int b = 0; b < ROUTING_MAX_BUSES; b++) gains[b] = 0.0f;
+    // The old paplay modes: "default" is what you hear, "mic" what others hear
+    int monitor = routing_find_bus(routing, "monitor");
+    int mic = routing_find_bus(routing, "mic");
+    if (monitor < 0) monitor = 0;
+    if (strcmp(mode, "default") == 0) {
+        gains[monitor] = 1.0f;
+        return 1;
+    }
+    if (strcmp(mode, "mic") == 0 || strcmp(mode, "both") == 0) {
+        if (mic < 0) return 0;
+        gains[mic] = 1.0f;
+        if (mode[0] == 'b') gains[monitor] = 1.0f;
+        return 1;
+    }
+    return apply_gain_list(routing, mode, gains);
+}
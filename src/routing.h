@@ -0,0 +1,34 @@
+#ifndef ROUTING_H
+#define ROUTING_H
+#include "config_store.h"
+// Routing matrix: named output buses, each feeding one sink, and a gain for
+// every sound on every bus. Configured in config.txt:
+//   bus:<name>|<sink>|<default gain>|<description>
+//   gain:<sound id>|<bus>=<gain>,<bus>=<gain>||<description>
+// Sounds without a gain line use each bus's default gain. Without any bus
+// lines the two classic outputs are used: "monitor" (soundboard_local, what
+// you hear) and "mic" (soundboard_output, what others hear).
+#define ROUTING_MAX_BUSES 8
+#define ROUTING_NAME_MAX 32
+#define ROUTING_SINK_MAX 128
+typedef struct {
+    char name[ROUTING_NAME_MAX];
+    char sink[ROUTING_SINK_MAX];
+    float default_gain;
+} Bus;
+typedef struct {
+    Bus buses[ROUTING_MAX_BUSES];
+    int bus_count;
+} Routing;
+
+// Read the bus lines of a config (or the two default buses)
+void routing_load(Routing *routing, ConfigStore *store);
+// 1 if both describe the same buses on the same sinks (gains may differ)
+int routing_same_buses(const Routing *a, const Routing *b);
+int routing_find_bus(const Routing *routing, const char *name);
+// Gain row of a sound: its gain line applied over the bus defaults
+void routing_sound_gains(const Routing *routing, ConfigStore *store, const char *id, float *gains);
+// Gain row for an explicit play mode: "default", "mic", "both", a bus name or
+// a "<bus>=<gain>,..." list. Returns 0 if it names an unknown bus.
+int routing_parse_mode(const Routing *routing, const char *mode, float *gains);
+#endif
@@ -0,0 +1,177 @@
+#include "sample_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sndfile.h>
+
+void sample_cache_init(SampleCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+    pthread_mutex_init(&cache->lock, NULL);
+}
+void sample_cache_destroy(SampleCache *cache) {
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->samples[i]->path);
+        sample_codec_free(&cache->samples[i]->audio);
+        free(cache->samples[i]);
+    }
+    free(cache->samples);
+    pthread_mutex_destroy(&cache->lock);
+}
+Sample *sample_cache_get(SampleCache *cache, const char *path) {
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->count; i++) {
+        if (strcmp(cache->samples[i]->path, path) == 0) {
+            pthread_mutex_unlock(&cache->lock);
+            return cache->samples[i];
+        }
+    }
+    if (cache->count == cache->capacity) {
+        int capacity = cache->capacity ? cache->capacity * 2 : 64;
+        Sample **samples = realloc(cache->samples, capacity * sizeof(Sample *));
+        if (!samples) {
+            pthread_mutex_unlock(&cache->lock);
+            return NULL;
+        }
+        cache->samples = samples;
+        cache->capacity = capacity;
+    }
+    Sample *sample = calloc(1, sizeof(Sample));
+    if (sample) {
+        sample->path = strdup(path);
+        cache->samples[cache->count++] = sample;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return sample;
+}
+// Linear resampler, good enough for one-shot effects and done once at load time
+static float *resample(float *pcm, size_t frames, int rate, size_t *out_frames) {
+    size_t count = (size_t)((double)frames * SAMPLE_RATE / rate);
+    float *out = malloc((count ? count : 1) * SAMPLE_CHANNELS * sizeof(float));
+    if (!out) return NULL;
+    double step = (double)rate / SAMPLE_RATE;
+    for (size_t i = 0; i < count; i++) {
+        double pos = i * step;
+        size_t index = (size_t)pos;
+        float frac = (float)(pos - index);
+        size_t next = index + 1 < frames ? index + 1 : index;
+        for (int c = 0; c < SAMPLE_CHANNELS; c++) {
+            float a = pcm[index * SAMPLE_CHANNELS + c];
+            float b = pcm[next * SAMPLE_CHANNELS + c];
+            out[i * SAMPLE_CHANNELS + c] = a + (b - a) * frac;
+        }
+    }
+    *out_frames = count;
+    return out;
+}
+// Decode any libsndfile-readable file into interleaved stereo float at SAMPLE_RATE
+static float *decode_file(const char *path, size_t *frames_out) {
+    SF_INFO info = {0};
+    SNDFILE *file = sf_open(path, SFM_READ, &info);
+    if (!file) {
+        printf("Error: Could not decode %s: %s\n", path, sf_strerror(NULL));
+        return NULL;
+    }
+    size_t capacity = info.frames > 0 ? (size_t)info.frames : SAMPLE_RATE;
+    size_t frames = 0;
+    float *pcm = malloc(capacity * SAMPLE_CHANNELS * sizeof(float));
+    float *chunk = malloc(4096 * info.channels * sizeof(float));
+    sf_count_t got;
+    while (pcm && chunk && (got = sf_readf_float(file, chunk, 4096)) > 0) {
+        if (frames + got > capacity) {
+            capacity = (frames + got) * 2;
+            float *grown = realloc(pcm, capacity * SAMPLE_CHANNELS * sizeof(float));
+            if (!grown) {
+                free(pcm);
+                pcm = NULL;
+                break;
+            }
+            pcm = grown;
+        }
+        for (sf_count_t i = 0; i < got; i++) {
+            float left = chunk[i * info.channels];
+            float right = info.channels > 1 ? chunk[i * info.channels + 1] : left;
+            pcm[(frames + i) * SAMPLE_CHANNELS] = left;
+            pcm[(frames + i) * SAMPLE_CHANNELS + 1] = right;
+        }
+        frames += got;
+    }
+    free(chunk);
+    sf_close(file);
+    if (pcm && info.samplerate != SAMPLE_RATE && info.samplerate > 0) {
+        float *converted = resample(pcm, frames, info.samplerate, &frames);
+        free(pcm);
+        pcm = converted;
+    }
+    *frames_out = frames;
+    return pcm;
+}
+int sample_cache_load(SampleCache *cache, Sample *sample) {
+    pthread_mutex_lock(&cache->lock);
+    int resident = sample_resident(sample);
+    pthread_mutex_unlock(&cache->lock);
+    if (resident) return 1;
+    // Decode and pack without the lock so the mixer and triggers are never held up by disk or codec
+    size_t frames = 0;
+    float *pcm = decode_file(sample->path, &frames);
+    if (!pcm) return 0;
+    EncodedAudio audio;
+    int encoded = sample_codec_encode(&audio, pcm, frames);
+    free(pcm);
+    if (!encoded) {
+        printf("Error: Out of memory packing %s\n", sample->path);
+        return 0;
+    }
+    pthread_mutex_lock(&cache->lock);
+    if (sample_resident(sample)) {
+        sample_codec_free(&audio);  // someone else finished first
+    } else {
+        sample->audio = audio;
+        sample->frames = frames;
+        sample->bytes = sample_codec_bytes(&audio);
+        sample->last_used = ++cache->clock;
+        cache->resident_bytes += sample->bytes;
+        cache->resident_frames += frames;
+        cache->decodes++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return 1;
+}
+int sample_cache_acquire(SampleCache *cache, Sample *sample) {
+    pthread_mutex_lock(&cache->lock);
+    int ok = sample_resident(sample);
+    if (ok) {
+        sample->voices++;
+        sample->last_used = ++cache->clock;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return ok;
+}
+void sample_cache_release(SampleCache *cache, Sample *sample) {
+    pthread_mutex_lock(&cache->lock);
+    sample->voices--;
+    pthread_mutex_unlock(&cache->lock);
+}
+void sample_cache_touch(SampleCache *cache, Sample *sample) {
+    pthread_mutex_lock(&cache->lock);
+    sample->last_used = ++cache->clock;
+    pthread_mutex_unlock(&cache->lock);
+}
+void sample_cache_evict(SampleCache *cache, size_t budget) {
+    pthread_mutex_lock(&cache->lock);
+    while (cache->resident_bytes > budget) {
+        Sample *victim = NULL;
+        for (int i = 0; i < cache->count; i++) {
+            Sample *sample = cache->samples[i];
+            if (sample_resident(sample) && !sample->in_window && sample->voices == 0 &&
+                (!victim || sample->last_used < victim->last_used)) {
+                victim = sample;
+            }
+        }
+        if (!victim) break;  // everything left is in use or in the bank window
+        sample_codec_free(&victim->audio);
+        cache->resident_bytes -= victim->bytes;
+        cache->resident_frames -= victim->frames;
+        victim->bytes = 0;
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
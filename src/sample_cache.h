@@ -0,0 +1,48 @@
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+#include <stddef.h>
+#include <pthread.h>
+#include "sample_codec.h"
+// Decoded sounds shared by every bank. Sample structs live for the whole
+// daemon lifetime so pointers stay valid; only their audio is paged in and out.
+// Resident audio is kept in the compact sample_codec format (2-5x smaller than
+// float PCM depending on the content) and voices decode it block by block while mixing.
+#define SAMPLE_RATE 48000
+#define SAMPLE_CHANNELS 2
+typedef struct {
+    char *path;
+    EncodedAudio audio;      // stereo at SAMPLE_RATE, words == NULL while paged out
+    size_t frames;
+    size_t bytes;
+    int voices;              // voices currently reading audio, never evicted while > 0
+    int in_window;           // used by the active bank or its neighbours
+    unsigned long last_used;
+} Sample;
+typedef struct {
+    pthread_mutex_t lock;    // guards audio/voices/in_window and the counters below
+    Sample **samples;
+    int count;
+    int capacity;
+    size_t resident_bytes;
+    size_t resident_frames;  // to report what the same audio would cost as float PCM
+    unsigned long clock;
+    unsigned long decodes;
+    unsigned long misses;    // triggers that had to decode before playing
+} SampleCache;
+
+void sample_cache_init(SampleCache *cache);
+void sample_cache_destroy(SampleCache *cache);
+// Find or register a sound file (does not decode it)
+Sample *sample_cache_get(SampleCache *cache, const char *path);
+// Decode the file if it is not resident. Returns 1 once audio is available.
+int sample_cache_load(SampleCache *cache, Sample *sample);
+// Pin audio for a voice (returns 0 if paged out) / drop that pin again
+int sample_cache_acquire(SampleCache *cache, Sample *sample);
+void sample_cache_release(SampleCache *cache, Sample *sample);
+void sample_cache_touch(SampleCache *cache, Sample *sample);
+// Page out least recently used samples outside the bank window until under budget
+void sample_cache_evict(SampleCache *cache, size_t budget);
+static inline int sample_resident(const Sample *sample) {
+    return sample->audio.words != NULL;
+}
+#endif
@@ -0,0 +1,248 @@
+#include "sample_codec.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static int32_t quantize(float value) {
+    float scaled = value * 32768.0f;
+    if (scaled > 32767.0f) return 32767;
+    if (scaled < -32768.0f) return -32768;
+    return (int32_t)lrintf(scaled);
+}
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+static int bit_width(uint32_t value) {
+    return value ? 32 - __builtin_clz(value) : 0;
+}
+// Word buffer that grows as blocks are packed
+typedef struct {
+    uint32_t *words;
+    size_t count;
+    size_t capacity;
+} WordBuffer;
+static int reserve_words(WordBuffer *buffer, size_t extra) {
+    if (buffer->count + extra <= buffer->capacity) return 1;
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+    while (capacity < buffer->count + extra) capacity *= 2;
+    uint32_t *words = realloc(buffer->words, capacity * sizeof(uint32_t));
+    if (!words) return 0;
+    buffer->words = words;
+    buffer->capacity = capacity;
+    return 1;
+}
+static int pack(WordBuffer *buffer, const uint32_t *values, size_t count, int width) {
+    size_t words = (count * width + 31) / 32;
+    if (!reserve_words(buffer, words)) return 0;
+    uint32_t *out = buffer->words + buffer->count;
+    memset(out, 0, words * sizeof(uint32_t));
+    uint64_t bits = 0;
+    int filled = 0;
+    for (size_t i = 0; i < count; i++) {
+        bits |= (uint64_t)values[i] << filled;
+        filled += width;
+        if (filled >= 32) {
+            *out++ = (uint32_t)bits;
+            bits >>= 32;
+            filled -= 32;
+        }
+    }
+    if (filled > 0) *out = (uint32_t)bits;
+    buffer->count += words;
+    return 1;
+}
+// Residuals of both predictors for one channel; keeps the narrower one
+typedef struct {
+    uint32_t residuals[2][SAMPLE_CODEC_BLOCK];
+    int order;
+    int width;
+} ChannelFit;
+static void fit_channel(ChannelFit *fit, const int32_t *x, size_t count, int32_t last, int32_t slope) {
+    uint32_t max_first = 0, max_second = 0;
+    for (size_t i = 0; i < count; i++) {
+        fit->residuals[0][i] = zigzag(x[i] - last);
+        fit->residuals[1][i] = zigzag(x[i] - last - slope);
+        max_first |= fit->residuals[0][i];
+        max_second |= fit->residuals[1][i];
+        slope = x[i] - last;
+        last = x[i];
+    }
+    int width_first = bit_width(max_first), width_second = bit_width(max_second);
+    fit->order = width_second < width_first ? 2 : 1;
+    fit->width = fit->order == 2 ? width_second : width_first;
+}
+int sample_codec_encode(EncodedAudio *audio, const float *pcm, size_t frames) {
+    memset(audio, 0, sizeof(*audio));
+    audio->frames = frames;
+    audio->block_count = (frames + SAMPLE_CODEC_BLOCK - 1) / SAMPLE_CODEC_BLOCK;
+    audio->blocks = calloc(audio->block_count ? audio->block_count : 1, sizeof(SampleBlock));
+    if (!audio->blocks) return 0;
+    static __thread ChannelFit fits[4];   // left, right, mid, side
+    WordBuffer buffer = {0};
+    int32_t x[4][SAMPLE_CODEC_BLOCK];
+    // The two frames before the current block, as [frame][channel] (0 = older)
+    int32_t history[2][SAMPLE_CODEC_CHANNELS] = {{0}};
+    for (size_t b = 0; b < audio->block_count; b++) {
+        size_t start = b * SAMPLE_CODEC_BLOCK;
+        size_t count = frames - start < SAMPLE_CODEC_BLOCK ? frames - start : SAMPLE_CODEC_BLOCK;
+        SampleBlock *block = &audio->blocks[b];
+        for (size_t i = 0; i < count; i++) {
+            int32_t left = quantize(pcm[(start + i) * 2]);
+            int32_t right = quantize(pcm[(start + i) * 2 + 1]);
+            x[0][i] = left;
+            x[1][i] = right;
+            x[2][i] = (left + right) >> 1;
+            x[3][i] = left - right;
+        }
+        int32_t seeds[4][2];  // per candidate channel: sample before the block, and the one before that
+        for (int h = 0; h < 2; h++) {
+            int32_t left = history[h][0], right = history[h][1];
+            seeds[0][h] = left;
+            seeds[1][h] = right;
+            seeds[2][h] = (left + right) >> 1;
+            seeds[3][h] = left - right;
+        }
+        for (int c = 0; c < 4; c++) {
+            fit_channel(&fits[c], x[c], count, seeds[c][1], seeds[c][1] - seeds[c][0]);
+        }
+        block->mid_side = fits[2].width + fits[3].width < fits[0].width + fits[1].width;
+        for (int c = 0; c < SAMPLE_CODEC_CHANNELS; c++) {
+            int source = block->mid_side ? c + 2 : c;
+            ChannelFit *fit = &fits[source];
+            block->last[c] = seeds[source][1];
+            block->slope[c] = seeds[source][1] - seeds[source][0];
+            block->offset[c] = (uint32_t)buffer.count;
+            block->order[c] = fit->order;
+            block->width[c] = fit->width;
+            if (!pack(&buffer, fit->residuals[fit->order - 1], count, fit->width)) {
+                free(buffer.words);
+                sample_codec_free(audio);
+                return 0;
+            }
+        }
+        for (int c = 0; c < SAMPLE_CODEC_CHANNELS; c++) {
+            history[0][c] = count >= 2 ? x[c][count - 2] : history[1][c];
+            history[1][c] = x[c][count - 1];
+        }
+    }
+    // One spare word so the decoder can always read 64 bits at a time
+    if (!reserve_words(&buffer, 1)) {
+        free(buffer.words);
+        sample_codec_free(audio);
+        return 0;
+    }
+    buffer.words[buffer.count++] = 0;
+    uint32_t *shrunk = realloc(buffer.words, buffer.count * sizeof(uint32_t));
+    audio->words = shrunk ? shrunk : buffer.words;
+    audio->word_count = buffer.count;
+    return 1;
+}
+void sample_codec_free(EncodedAudio *audio) {
+    free(audio->words);
+    free(audio->blocks);
+    memset(audio, 0, sizeof(*audio));
+}
+size_t sample_codec_bytes(const EncodedAudio *audio) {
+    return audio->word_count * sizeof(uint32_t) + audio->block_count * sizeof(SampleBlock);
+}
+static void unpack(const uint32_t *words, size_t count, int width, int32_t *out) {
+    if (width == 0) {
+        memset(out, 0, count * sizeof(int32_t));
+        return;
+    }
+    uint64_t mask = (1ULL << width) - 1;
+    size_t bit = 0;
+    for (size_t i = 0; i < count; i++, bit += width) {
+        const uint32_t *word = words + (bit >> 5);
+        uint64_t window = word[0] | ((uint64_t)word[1] << 32);
+        out[i] = (int32_t)((window >> (bit & 31)) & mask);
+    }
+}
+// Undo zigzag and integrate: out[i] = seed + sum(residuals[0..i])
+static int32_t integrate(int32_t *values, size_t count, int32_t seed, int zigzagged) {
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i carry = _mm_set1_epi32(seed);
+    const __m128i one = _mm_set1_epi32(1);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        if (zigzagged) {
+            v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+        }
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        _mm_storeu_si128((__m128i *)(values + i), v);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    seed = _mm_cvtsi128_si32(carry);
+#endif
+    for (; i < count; i++) {
+        uint32_t u = (uint32_t)values[i];
+        int32_t residual = zigzagged ? (int32_t)((u >> 1) ^ -(u & 1)) : values[i];
+        seed += residual;
+        values[i] = seed;
+    }
+    return seed;
+}
+// mid = (L+R)>>1, side = L-R  ->  L, R (in place)
+static void restore_left_right(int32_t *mid, int32_t *side, size_t count) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi32(1);
+    for (; i + 4 <= count; i += 4) {
+        __m128i m = _mm_loadu_si128((const __m128i *)(mid + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(side + i));
+        m = _mm_or_si128(_mm_slli_epi32(m, 1), _mm_and_si128(s, one));
+        _mm_storeu_si128((__m128i *)(mid + i), _mm_srai_epi32(_mm_add_epi32(m, s), 1));
+        _mm_storeu_si128((__m128i *)(side + i), _mm_srai_epi32(_mm_sub_epi32(m, s), 1));
+    }
+#endif
+    for (; i < count; i++) {
+        int32_t m = (mid[i] * 2) | (side[i] & 1);
+        int32_t s = side[i];
+        mid[i] = (m + s) >> 1;
+        side[i] = (m - s) >> 1;
+    }
+}
+size_t sample_codec_decode_block(const EncodedAudio *audio, size_t block_index, float *out) {
+    if (block_index >= audio->block_count) return 0;
+    const SampleBlock *block = &audio->blocks[block_index];
+    size_t start = block_index * SAMPLE_CODEC_BLOCK;
+    size_t count = audio->frames - start < SAMPLE_CODEC_BLOCK ? audio->frames - start : SAMPLE_CODEC_BLOCK;
+    int32_t channels[SAMPLE_CODEC_CHANNELS][SAMPLE_CODEC_BLOCK];
+    for (int c = 0; c < SAMPLE_CODEC_CHANNELS; c++) {
+        int32_t *x = channels[c];
+        unpack(audio->words + block->offset[c], count, block->width[c], x);
+        if (block->order[c] == 2) {
+            // Residuals integrate to the slope, the slope integrates to the signal
+            integrate(x, count, block->slope[c], 1);
+            integrate(x, count, block->last[c], 0);
+        } else {
+            integrate(x, count, block->last[c], 1);
+        }
+    }
+    if (block->mid_side) {
+        restore_left_right(channels[0], channels[1], count);
+    }
+    const float scale = 1.0f / 32768.0f;
+    const int32_t *left = channels[0], *right = channels[1];
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 4 <= count; i += 4) {
+        __m128 l = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(left + i))), vscale);
+        __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(right + i))), vscale);
+        _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i * 2] = left[i] * scale;
+        out[i * 2 + 1] = right[i] * scale;
+    }
+    return count;
+}
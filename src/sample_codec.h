@@ -0,0 +1,37 @@
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+#include <stddef.h>
+#include <stdint.h>
+// Compact in-memory format for the sample cache.
+// Audio is quantized to 16 bit (the resolution the sounds were mastered at),
+// then each block of SAMPLE_CODEC_BLOCK frames stores, per channel, fixed-width
+// bit-packed residuals of a first or second order predictor, on either left/right
+// or mid/side channels (whichever packs smaller, as in FLAC). Every block carries
+// its own predictor seeds, so any block can be decoded on its own.
+// Decoding is unpack -> zigzag -> prefix sum -> float, vectorised with SSE2.
+#define SAMPLE_CODEC_BLOCK 1024
+#define SAMPLE_CODEC_CHANNELS 2
+typedef struct {
+    uint32_t offset[SAMPLE_CODEC_CHANNELS];   // first word of each channel's residuals
+    uint8_t width[SAMPLE_CODEC_CHANNELS];     // bits per residual (0 = constant)
+    uint8_t order[SAMPLE_CODEC_CHANNELS];     // predictor order, 1 or 2
+    uint8_t mid_side;                         // channels are (L+R)>>1 and L-R
+    int32_t last[SAMPLE_CODEC_CHANNELS];      // sample before the block
+    int32_t slope[SAMPLE_CODEC_CHANNELS];     // last - the sample before it
+} SampleBlock;
+typedef struct {
+    uint32_t *words;
+    size_t word_count;
+    SampleBlock *blocks;
+    size_t block_count;
+    size_t frames;
+} EncodedAudio;
+
+// Encode interleaved stereo float. Returns 1 on success.
+int sample_codec_encode(EncodedAudio *audio, const float *pcm, size_t frames);
+void sample_codec_free(EncodedAudio *audio);
+size_t sample_codec_bytes(const EncodedAudio *audio);
+// Decode one block into interleaved stereo float (SAMPLE_CODEC_BLOCK frames of
+// room). Returns the number of frames written.
+size_t sample_codec_decode_block(const EncodedAudio *audio, size_t block, float *out);
+#endif
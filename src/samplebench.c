@@ -0,0 +1,129 @@
+// samplebench - size versus speed of the sample cache codec.
+// Encodes a few synthetic 10 second signals and reports compression ratio against
+// raw float PCM, encode/decode speed as a multiple of real time, random block
+// access latency and the worst sample error.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "sample_codec.h"
+
+#define BENCH_RATE 48000
+#define BENCH_SECONDS 10
+#define BENCH_FRAMES (BENCH_RATE * BENCH_SECONDS)
+
+typedef void (*SignalFn)(float *pcm, size_t frames);
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static float noise(unsigned *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / (1 << 24) * 2.0f - 1.0f;
+}
+static void signal_sweep(float *pcm, size_t frames) {
+    double phase = 0;
+    for (size_t i = 0; i < frames; i++) {
+        double freq = 50.0 + 8000.0 * i / frames;
+        phase += 2 * M_PI * freq / BENCH_RATE;
+        pcm[i * 2] = 0.8f * (float)sin(phase);
+        pcm[i * 2 + 1] = 0.8f * (float)sin(phase + 0.3);
+    }
+}
+// Band-limited noise with a syllable-rate envelope, roughly like speech or a crowd
+static void signal_voice(float *pcm, size_t frames) {
+    unsigned state = 1;
+    float low = 0;
+    for (size_t i = 0; i < frames; i++) {
+        low += 0.08f * (noise(&state) - low);
+        float envelope = 0.5f + 0.5f * (float)sin(2 * M_PI * 4.0 * i / BENCH_RATE);
+        pcm[i * 2] = pcm[i * 2 + 1] = 2.0f * low * envelope;
+    }
+}
+// Decaying low tone plus a noise click, like an air horn or a drum hit
+static void signal_hit(float *pcm, size_t frames) {
+    unsigned state = 7;
+    for (size_t i = 0; i < frames; i++) {
+        size_t t = i % BENCH_RATE;
+        float decay = expf(-(float)t / (BENCH_RATE / 6));
+        float click = t < 400 ? 0.5f * noise(&state) : 0.0f;
+        float tone = 0.7f * decay * (float)sin(2 * M_PI * 110.0 * t / BENCH_RATE);
+        pcm[i * 2] = tone + click;
+        pcm[i * 2 + 1] = 0.9f * tone + click;
+    }
+}
+static void signal_white(float *pcm, size_t frames) {
+    unsigned state = 3;
+    for (size_t i = 0; i < frames * 2; i++) {
+        pcm[i] = 0.5f * noise(&state);
+    }
+}
+static void run(const char *name, SignalFn fill, float *pcm, float *block) {
+    fill(pcm, BENCH_FRAMES);
+    EncodedAudio audio;
+    double start = now_seconds();
+    if (!sample_codec_encode(&audio, pcm, BENCH_FRAMES)) {
+        printf("%-8s encode failed\n", name);
+        return;
+    }
+    double encode_time = now_seconds() - start;
+
+    int passes = 20;
+    float max_error = 0;
+    start = now_seconds();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t b = 0; b < audio.block_count; b++) {
+            size_t frames = sample_codec_decode_block(&audio, b, block);
+            if (pass == 0) {
+                const float *ref = pcm + b * SAMPLE_CODEC_BLOCK * 2;
+                for (size_t i = 0; i < frames * 2; i++) {
+                    float error = fabsf(block[i] - fmaxf(-1.0f, fminf(ref[i], 32767.0f / 32768.0f)));
+                    if (error > max_error) max_error = error;
+                }
+            }
+        }
+    }
+    double decode_time = (now_seconds() - start) / passes;
+
+    // Random access: decode scattered blocks as a voice starting mid-sample would
+    unsigned state = 11;
+    int seeks = 20000;
+    start = now_seconds();
+    for (int i = 0; i < seeks; i++) {
+        state = state * 1664525u + 1013904223u;
+        sample_codec_decode_block(&audio, (state >> 8) % audio.block_count, block);
+    }
+    double seek_time = (now_seconds() - start) / seeks;
+
+    double raw_mb = BENCH_FRAMES * 2 * sizeof(float) / 1048576.0;
+    double packed_mb = sample_codec_bytes(&audio) / 1048576.0;
+    printf("%-8s %7.2f MB -> %6.2f MB  %5.2fx  encode %6.0fx  decode %7.0fx rt (%6.0f MB/s)  block %5.2f us  max err %.1e\n",
+           name, raw_mb, packed_mb, raw_mb / packed_mb,
+           BENCH_SECONDS / encode_time, BENCH_SECONDS / decode_time, raw_mb / decode_time,
+           seek_time * 1e6, max_error);
+    sample_codec_free(&audio);
+}
+int main(void) {
+    float *pcm = malloc(BENCH_FRAMES * 2 * sizeof(float));
+    float *block = malloc(SAMPLE_CODEC_BLOCK * 2 * sizeof(float));
+    if (!pcm || !block) {
+        printf("Error: Failed to allocate benchmark buffers\n");
+        return 1;
+    }
+#ifdef __SSE2__
+    printf("Sample codec benchmark (SSE2 decode), %d s stereo at %d Hz per signal\n", BENCH_SECONDS, BENCH_RATE);
+#else
+    printf("Sample codec benchmark (scalar decode), %d s stereo at %d Hz per signal\n", BENCH_SECONDS, BENCH_RATE);
+#endif
+    printf("signal    raw float    packed     ratio\n");
+    run("sweep", signal_sweep, pcm, block);
+    run("voice", signal_voice, pcm, block);
+    run("hit", signal_hit, pcm, block);
+    run("white", signal_white, pcm, block);
+    free(pcm);
+    free(block);
+    return 0;
+}
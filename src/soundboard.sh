@@ -20,6 +20,17 @@ fi
 CONFIG_FILE="$SOUNDBOARD_DIR/config.txt"
 VIRTUAL_MIC="soundboard_output"
 
+# Native config tool (bundled next to this script, or on PATH). Falls back to bash loops if missing.
+CONFIG_TOOL="$SCRIPT_DIR/soundboardcfg"
+if [ ! -x "$CONFIG_TOOL" ]; then
+    CONFIG_TOOL="$(command -v soundboardcfg 2>/dev/null)"
+fi
+# Native audio engine (sound banks, preloaded samples). Without it sounds play through paplay.
+ENGINE="$SCRIPT_DIR/soundboardd"
+if [ ! -x "$ENGINE" ]; then
+    ENGINE="$(command -v soundboardd 2>/dev/null)"
+fi
+
 # Ensure config directory exists
 mkdir -p "$SOUNDBOARD_DIR"
 
@@ -75,7 +86,23 @@ check_audio_system() {
 
     return 0
 }
+print_mic_help() {
+    echo "Virtual microphone created! Select 'SB-Microphone' as input in your applications."
+    echo "This will now pass through both your real microphone AND soundboard audio."
+    echo "Volume controls in your mixer:"
+    echo "  - 'Soundboard-Headphones' = Your local volume (what you hear)"
+    echo "  - 'Soundboard-Output' = Volume others hear in Discord/games"
+    echo "  - 'Soundboard-Combined' = Internal mixer (leave alone)"
+}
 setup_virtual_mic() {
+    # The engine builds the devices over one server connection and recreates
+    # them by itself if the audio server restarts
+    if start_engine; then
+        "$ENGINE" setup
+        print_mic_help
+        pgrep xbindkeys >/dev/null || xbindkeys 2>/dev/null &  # Start keybind handler
+        return
+    fi
     if ! pactl list sources short | grep -q "$VIRTUAL_MIC"; then
         echo "Setting up virtual microphone with real mic passthrough..."
         pactl load-module module-null-sink sink_name="$VIRTUAL_MIC" sink_properties=device.description="Soundboard-Output"
@@ -90,23 +117,63 @@ setup_virtual_mic() {
         pactl load-module module-loopback source="soundboard_local.monitor" sink="$DEFAULT_SINK" latency_msec=1
         pactl load-module module-remap-source source_name="${VIRTUAL_MIC}_mic" source_properties=device.description="SB-Microphone" master="soundboard_combined.monitor"
         pactl set-sink-volume soundboard_local 50%
-        echo "Virtual microphone created! Select 'SB-Microphone' as input in your applications."
-        echo "This will now pass through both your real microphone AND soundboard audio."
-        echo "Volume controls in your mixer:"
-        echo "  - 'Soundboard-Headphones' = Your local volume (what you hear)"
-        echo "  - 'Soundboard-Output' = Volume others hear in Discord/games"
-        echo "  - 'Soundboard-Combined' = Internal mixer (leave alone)"
+        print_mic_help
         xbindkeys 2>/dev/null &  # Start keybind handler
     else
         echo "Virtual microphone already exists."
     fi
+    setup_buses
+    warm_sounds
+}
+# Sink names of the extra buses declared with "bus:<name>|<sink>|..." lines in config.txt
+bus_sinks() {
+    [ -f "$CONFIG_FILE" ] || return
+    grep '^bus:' "$CONFIG_FILE" | cut -d'|' -f2 | while read -r sink; do
+        [ -n "$sink" ] && [ "$sink" != "$VIRTUAL_MIC" ] && [ "$sink" != "soundboard_local" ] && echo "$sink"
+    done
+}
+# Without the engine: create the extra bus sinks with pactl
+setup_buses() {
+    bus_sinks | while read -r sink; do
+        if ! pactl list sinks short | cut -f2 | grep -qx "$sink"; then
+            echo "Creating sink $sink for a soundboard bus (record from $sink.monitor)"
+            pactl load-module module-null-sink sink_name="$sink" sink_properties=device.description="Soundboard-Bus-$sink" >/dev/null
+        fi
+    done
+}
+start_engine() {
+    [ -x "$ENGINE" ] || return 1
+    if "$ENGINE" ping >/dev/null 2>&1; then
+        "$ENGINE" reload >/dev/null
+        return 0
+    fi
+    echo "Starting soundboard engine..."
+    "$ENGINE" -c "$CONFIG_FILE" >/dev/null 2>&1 &
+    # It answers once it has connected to the audio server
+    for attempt in 1 2 3 4 5 6 7 8 9 10; do
+        "$ENGINE" ping >/dev/null 2>&1 && return 0
+        sleep 0.5
+    done
+    echo "Warning: soundboard engine did not start, falling back to pactl"
+    return 1
+}
+reload_engine() {
+    [ -x "$ENGINE" ] && "$ENGINE" reload >/dev/null 2>&1
+}
+# The engine warms the page cache after every reload; without it, read the
+# key-bound files ahead once so the first paplay does not wait on the disk
+warm_sounds() {
+    [ -x "$CONFIG_TOOL" ] && [ -f "$CONFIG_FILE" ] && "$CONFIG_TOOL" "$CONFIG_FILE" warm "$SOUNDBOARD_DIR"
 }
 cleanup_virtual_mic() {
     echo "Cleaning up virtual microphone setup..."
     stop_all # Silence everything
-    pactl list modules short | grep -E "(soundboard|$VIRTUAL_MIC)" | cut -f1 | while read module_id; do
-        pactl unload-module "$module_id" 2>/dev/null
-    done
+    if [ -x "$ENGINE" ] && "$ENGINE" teardown 2>/dev/null; then
+        "$ENGINE" quit >/dev/null 2>&1
+        echo "Soundboard engine stopped."
+    else
+        cleanup_modules
+    fi
 
     echo "Stopping xbindkeys..."
     if pgrep xbindkeys > /dev/null; then
@@ -117,6 +184,17 @@ cleanup_virtual_mic() {
     fi
     echo "Virtual microphone cleanup complete."
 }
+# Without the engine: find and unload the soundboard modules with pactl
+cleanup_modules() {
+    pactl list modules short | grep -E "(soundboard|$VIRTUAL_MIC)" | cut -f1 | while read module_id; do
+        pactl unload-module "$module_id" 2>/dev/null
+    done
+    bus_sinks | while read -r sink; do
+        pactl list modules short | grep "sink_name=$sink " | cut -f1 | while read module_id; do
+            pactl unload-module "$module_id" 2>/dev/null
+        done
+    done
+}
 update_config() {
     echo "Scanning for audio files and updating config..."
     if [ ! -f "$CONFIG_FILE" ]; then
@@ -129,11 +207,19 @@ update_config() {
     local existing_files_temp=$(mktemp)
     local existing_keybinds_temp=$(mktemp)
     local existing_descriptions_temp=$(mktemp)
+    local options_temp=$(mktemp)
     local max_id=0
     # Read existing config into temporary files
     while IFS='|' read -r id filename keybind description; do
         [[ "$id" =~ ^#.*$ ]] || [[ -z "$id" ]] && continue
 
+        # Keep engine, bus and gain settings ("kind:name" IDs) and the global
+        # command keys as they are; they have no sound file to find
+        if [[ "$id" == *:* ]] || [[ "$id" =~ ^(stop|bank_next|bank_prev)$ ]]; then
+            echo "$id|$filename|$keybind|$description" >> "$options_temp"
+            continue
+        fi
+
         # Only process numeric IDs for max_id calculation
         if [[ "$id" =~ ^[0-9]+$ ]] && [ "$id" -gt "$max_id" ]; then
             max_id="$id"
@@ -180,8 +266,9 @@ update_config() {
             fi
         done
     done
+    cat "$options_temp" >> "$temp_config"
     # Clean up temp files
-    rm "$existing_files_temp" "$existing_keybinds_temp" "$existing_descriptions_temp"
+    rm "$existing_files_temp" "$existing_keybinds_temp" "$existing_descriptions_temp" "$options_temp"
     # Replace old config with new one
     mv "$temp_config" "$CONFIG_FILE"
     echo "Config file updated!"
@@ -223,15 +310,22 @@ END_COMMENT
 # Aliased in bashrc so we can use 'soundboard' command instead of referencing entire path
     echo ""
     echo "Usage examples:"
-    echo "  soundboard 1              # Play sound #1 to default output"
+    echo "  soundboard 1              # Play sound #1 on its configured buses (local + mic by default)"
+    echo "  soundboard 1 default      # Play sound #1 to local output only"
     echo "  soundboard 1 mic          # Play sound #1 to virtual microphone"
     echo "  soundboard 1 both         # Play sound #1 to both outputs"
+    echo "  soundboard 1 rec,mic=0.5  # Play sound #1 on the 'rec' bus and at half volume on the mic"
     echo "  soundboard bind 1 KP_1    # Bind sound #1 to Numpad 1 (auto-updates xbindkeys)"
     echo "  soundboard unbind 1       # Remove keybind from sound #1"
     echo "  soundboard bind stop KP_0 # Bind stop command to a key"
+    echo "  soundboard bind 7 2:KP_1  # Bind sound #7 to Numpad 1 in bank 2"
+    echo "  soundboard bind bank_next KP_Add  # Key that switches to the next bank"
+    echo "  soundboard bank 2         # Switch to bank 2 (or next/prev)"
     echo "  soundboard volume 75      # Set local soundboard volume to 75%"
     echo "  soundboard keybinds       # Show current xbindkeys config"
     echo "  soundboard refresh        # Force refresh xbindkeys config"
+    echo "  soundboard describe 1 Hi  # Change the description of sound #1"
+    echo "  soundboard renumber 1 20  # Change the ID of sound #1 to #20"
     echo "  soundboard scan           # Scan for new audio files"
     echo "  soundboard setup          # Set up virtual microphone"
     echo "  soundboard stop           # Stop all playing sounds"
@@ -239,6 +333,12 @@ END_COMMENT
 }
 update_xbindkeys() {
     local xbindkeys_config="$HOME/.xbindkeysrc"
+    if [ -x "$CONFIG_TOOL" ]; then
+        "$CONFIG_TOOL" "$CONFIG_FILE" xbindkeys "$SOUNDBOARD_DIR" "$SCRIPT_PATH" "$xbindkeys_config" ${ENGINE:+"$ENGINE"} || return 1
+        reload_engine
+        restart_xbindkeys
+        return
+    fi
     local temp_config=$(mktemp)
 
     echo "# Soundboard xbindkeys configuration - AUTO GENERATED" > "$temp_config"
@@ -271,7 +371,10 @@ update_xbindkeys() {
     fi
 
     mv "$temp_config" "$xbindkeys_config"
-
+    reload_engine
+    restart_xbindkeys
+}
+restart_xbindkeys() {
     if pgrep xbindkeys > /dev/null; then
         echo "Restarting xbindkeys with updated config..."
         killall xbindkeys 2>/dev/null
@@ -291,6 +394,11 @@ bind_keybind() {
         echo "Example: $0 bind stop KP_0"
         return 1
     fi
+    if [ -x "$CONFIG_TOOL" ]; then
+        "$CONFIG_TOOL" "$CONFIG_FILE" bind "$sound_id" "$keybind" || return 1
+        update_xbindkeys
+        return
+    fi
     local temp_config=$(mktemp)
     local conflict_found=false
     local conflict_description=""
@@ -300,7 +408,7 @@ bind_keybind() {
         elif [ "$old_keybind" = "$keybind" ] && [ "$id" != "$sound_id" ]; then
             echo "$id|$filename||$description" >> "$temp_config"
             conflict_found=true
-            conflict_description="$description (#$id)"
+            conflict_description="${conflict_description:+$conflict_description, }$description (#$id)"
         else
             echo "$id|$filename|$old_keybind|$description" >> "$temp_config"
         fi
@@ -356,6 +464,11 @@ unbind_keybind() {
         echo "Example: $0 unbind 5"
         return 1
     fi
+    if [ -x "$CONFIG_TOOL" ]; then
+        "$CONFIG_TOOL" "$CONFIG_FILE" unbind "$sound_id" || return 1
+        update_xbindkeys
+        return
+    fi
     local temp_config=$(mktemp)
     local found=false
     while IFS='|' read -r id filename old_keybind description; do
@@ -421,6 +534,8 @@ show_keybind_commands() {
 }
 play_sound() {
     local sound_id=$1
+    # No mode means the sound's routing from config.txt on the engine; without
+    # the engine it plays locally, as it always has
     local output_mode=${2:-"default"}
 
     if [ ! -f "$CONFIG_FILE" ]; then
@@ -428,6 +543,25 @@ play_sound() {
         return 1
     fi
 
+    # Hand off to the engine when it is running; it mixes every bus in one pass.
+    # Only play it here when there is no engine to talk to (exit 2): a slow reply
+    # means the engine has the sound, and playing it again would double it.
+    if [ -x "$ENGINE" ]; then
+        "$ENGINE" play "$sound_id" ${2:+"$2"} 2>/dev/null
+        local status=$?
+        [ $status -ne 2 ] && return $status
+    fi
+
+    # Buses and per-bus gains are mixed by the engine; paplay only knows the original outputs
+    case "$output_mode" in
+        "default"|"mic"|"both") ;;
+        *)
+            echo "Output mode '$output_mode' needs soundboardd, which is not running."
+            echo "Run 'soundboard setup' to start it, or use default, mic or both."
+            return 1
+            ;;
+    esac
+
     # Check if virtual mic setup exists when using mic or both modes
     if [ "$output_mode" = "mic" ] || [ "$output_mode" = "both" ]; then
         if ! pactl list sinks short | grep -q "$VIRTUAL_MIC"; then
@@ -470,7 +604,7 @@ play_sound() {
             paplay --device="soundboard_local" "$target_file" &
             paplay --device="$VIRTUAL_MIC" "$target_file" &
             ;;
-        "default"|*)
+        "default")
             paplay --device="soundboard_local" "$target_file" &
             ;;
     esac
@@ -506,6 +640,7 @@ set_volume() {
 }
 stop_all() {
     echo "Stopping all soundboard audio..."
+    [ -x "$ENGINE" ] && "$ENGINE" stop >/dev/null 2>&1
     killall paplay 2>/dev/null
     echo "All sounds stopped."
 }
@@ -520,6 +655,21 @@ case "$1" in
         ;;
     "scan")
         update_config
+        # The engine creates sinks for new buses and warms sounds on reload;
+        # without it, do both here (sinks only once the soundboard is set up)
+        if ! reload_engine; then
+            warm_sounds
+            if pactl list sinks short 2>/dev/null | grep -q "$VIRTUAL_MIC"; then
+                setup_buses
+            fi
+        fi
+        ;;
+    "bank")
+        if [ -x "$ENGINE" ]; then
+            "$ENGINE" bank "${2:-next}"
+        else
+            echo "Sound banks need the soundboardd engine."
+        fi
         ;;
     "bind")
         bind_keybind "$2" "$3"
@@ -530,6 +680,13 @@ case "$1" in
     "refresh")
         update_xbindkeys
         ;;
+    "describe"|"renumber")
+        if [ -x "$CONFIG_TOOL" ]; then
+            "$CONFIG_TOOL" "$CONFIG_FILE" "$1" "$2" "$3" && update_xbindkeys
+        else
+            echo "soundboardcfg not found - '$1' needs the native config tool."
+        fi
+        ;;
     "volume")
         set_volume "$2"
         ;;
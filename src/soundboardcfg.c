@@ -0,0 +1,109 @@
+// soundboardcfg - command line front end to the shared config store.
+// Used by soundboard.sh so a rebind is one in-memory edit and one atomic save
+// instead of several passes over config.txt.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "config_store.h"
+#include "prefetch.h"
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s <config.txt> <command> [args]\n", prog);
+    printf("Commands:\n");
+    printf("  bind <sound_id|stop|bank_next|bank_prev> <keybind>\n");
+    printf("                                         Bind a key, \"2:KP_1\" = KP_1 in bank 2\n");
+    printf("  unbind <sound_id|stop>                 Remove a keybind\n");
+    printf("  describe <sound_id> <description>      Change a description\n");
+    printf("  renumber <old_id> <new_id>             Change a sound ID\n");
+    printf("  xbindkeys <sound_dir> <script> <out> [engine]\n");
+    printf("                                         Write an xbindkeys rc file\n");
+    printf("  warm <sound_dir>                       Read key-bound sound files into the page cache\n");
+}
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char *command = argv[2];
+    ConfigStore store;
+    if (!config_store_load(&store, argv[1])) {
+        return 1;
+    }
+    int result;
+    if (strcmp(command, "bind") == 0 && argc == 5) {
+        char **cleared_ids = NULL;
+        result = config_store_bind(&store, argv[3], argv[4], &cleared_ids);
+        for (int i = 0; result == CONFIG_OK && cleared_ids && cleared_ids[i]; i++) {
+            ConfigEntry *conflict = config_store_find(&store, cleared_ids[i]);
+            printf("Removed conflicting keybind '%s' from: %s (#%s)\n",
+                   argv[4], conflict ? conflict->description : "", cleared_ids[i]);
+        }
+        config_store_free_ids(cleared_ids);
+        if (result == CONFIG_OK) {
+            ConfigEntry *entry = config_store_find(&store, argv[3]);
+            if (!isdigit((unsigned char)argv[3][0])) {
+                printf("Bound %s command to key: %s\n", argv[3], argv[4]);
+            } else {
+                printf("Bound sound #%s (%s) to key: %s\n", entry->id, entry->description, argv[4]);
+            }
+        }
+    } else if (strcmp(command, "unbind") == 0 && argc == 4) {
+        ConfigEntry *entry = config_store_find(&store, argv[3]);
+        char *old_keybind = entry ? strdup(entry->keybind) : NULL;
+        result = config_store_unbind(&store, argv[3]);
+        if (result == CONFIG_OK && old_keybind[0]) {
+            printf("Removed keybind '%s' from sound #%s (%s)\n", old_keybind, entry->id, entry->description);
+        } else if (result == CONFIG_OK) {
+            printf("Sound #%s (%s) had no keybind to remove\n", entry->id, entry->description);
+        }
+        free(old_keybind);
+    } else if (strcmp(command, "describe") == 0 && argc == 5) {
+        result = config_store_set_description(&store, argv[3], argv[4]);
+        if (result == CONFIG_OK) printf("Updated description of sound #%s\n", argv[3]);
+    } else if (strcmp(command, "renumber") == 0 && argc == 5) {
+        result = config_store_set_id(&store, argv[3], argv[4]);
+        if (result == CONFIG_OK) {
+            printf("Sound #%s is now #%s\n", argv[3], argv[4]);
+        } else if (result == CONFIG_INVALID) {
+            printf("Sound ID %s is invalid or already in use!\n", argv[4]);
+        }
+    } else if (strcmp(command, "xbindkeys") == 0 && (argc == 6 || argc == 7)) {
+        int ok = config_store_write_xbindkeys(&store, argv[3], argv[4], argc == 7 ? argv[6] : NULL, argv[5]);
+        config_store_free(&store);
+        return ok ? 0 : 1;
+    } else if (strcmp(command, "warm") == 0 && argc == 4) {
+        // Without the engine every trigger is a paplay reading the file, so have it cached
+        int files = 0;
+        size_t bytes = 0;
+        for (int i = 0; i < store.count; i++) {
+            ConfigEntry *entry = &store.entries[i];
+            if (!entry->id || !isdigit((unsigned char)entry->id[0]) || !entry->keybind[0]) continue;
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", argv[3], entry->filename);
+            size_t size = prefetch_file(path);
+            if (size) {
+                files++;
+                bytes += size;
+            }
+        }
+        printf("Warming %d key-bound sound files (%zu KB)\n", files, bytes >> 10);
+        config_store_free(&store);
+        return 0;
+    } else {
+        print_usage(argv[0]);
+        config_store_free(&store);
+        return 1;
+    }
+    // Invalid changes and journal failures have already been reported
+    if (result == CONFIG_NOT_FOUND) {
+        printf("Sound ID %s not found!\n", argv[3]);
+    }
+    if (result != CONFIG_OK) {
+        config_store_free(&store);
+        return 1;
+    }
+    int ok = config_store_save(&store);
+    config_store_free(&store);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,553 @@
+// soundboardd - resident soundboard engine.
+// Run with no arguments (or -c <config.txt>) to start the daemon; any other
+// arguments (optionally after -c <config.txt>) are sent to the running daemon
+// as a command. "key" and "bank" start the daemon first if it is not running.
+// The client exits 1 if the command failed and 2 if no daemon is reachable, e.g.
+//   soundboardd key KP_1      play whatever KP_1 is bound to in the active bank
+//   soundboardd release KP_1  KP_1 went up (lets key auto-repeat be told apart from presses)
+//   soundboardd bank next     switch banks (also: prev, or a bank number; no argument reports the active one)
+//   soundboardd play 5        play sound #5 on its configured buses
+//   soundboardd play 5 mic    ... or on explicit ones (default, mic, both, <bus>, <bus>=<gain>,...)
+//   soundboardd setup         create the virtual devices (and keep them alive across server restarts)
+//   soundboardd teardown      remove them again
+//   soundboardd warm          re-warm the page cache for sounds that are not decoded
+//   soundboardd stop | reload | status | buses | graph | quit
+//   soundboardd stress 5000 1000 key KP_1   send a command 5000 times at 1000/s and report
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <libgen.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include "config_store.h"
+#include "engine_client.h"
+#include "sample_cache.h"
+#include "bank.h"
+#include "mixer.h"
+#include "routing.h"
+#include "audio_graph.h"
+#include "prefetch.h"
+
+#define ENGINE_MAX_KEYS 128
+#define ENGINE_HELD_TIMEOUT 1.0   // seconds a key counts as held without a release
+#define ENGINE_SERVER_WAIT_MS 3000
+#define ENGINE_START_WAIT_MS 5000  // includes waiting for the audio server
+// Client exit status
+#define CLIENT_EXIT_DOWN 2
+#define CLIENT_EXIT_NO_REPLY 3
+
+// Press/release times of one physical key, for auto-repeat suppression
+typedef struct {
+    char key[32];
+    double last_press;
+    double last_release;
+    int has_release;         // xbindkeys reports releases for this key
+} KeyState;
+typedef struct {
+    char config_path[1024];
+    char sound_dir[1024];
+    Routing routing;
+    SampleCache cache;
+    BankSet banks;
+    Prefetch prefetch;
+    Mixer mixer;
+    AudioGraph graph;
+    KeyState keys[ENGINE_MAX_KEYS];
+    int key_count;
+    double autorepeat;       // seconds, 0 = never treat a press as auto-repeat
+    unsigned long repeats;
+} Engine;
+
+static volatile sig_atomic_t keep_running = 1;
+static void handle_signal(int sig) {
+    (void)sig;
+    keep_running = 0;
+}
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static void load_limits(Engine *engine, ConfigStore *store) {
+    int polyphony = atoi(config_store_option(store, "engine:polyphony", "32"));
+    int steal = mixer_parse_steal(config_store_option(store, "engine:steal", "oldest"));
+    if (steal < 0) {
+        printf("Warning: Unknown engine:steal policy, using oldest\n");
+        steal = STEAL_OLDEST;
+    }
+    mixer_set_limits(&engine->mixer, polyphony, steal);
+    engine->autorepeat = atoi(config_store_option(store, "engine:autorepeat_ms", "50")) / 1000.0;
+    prefetch_set_pin_budget(&engine->prefetch, (size_t)atol(config_store_option(store, "engine:pin_mb", "0")) << 20);
+}
+static int load_config(Engine *engine) {
+    ConfigStore store;
+    if (!config_store_load(&store, engine->config_path)) {
+        return 0;
+    }
+    load_limits(engine, &store);
+    Routing routing;
+    routing_load(&routing, &store);
+    if (!routing_same_buses(&routing, &engine->routing)) {
+        printf("Bus layout changed, reopening sinks\n");
+        mixer_set_buses(&engine->mixer, &routing);
+        audio_graph_set_buses(&engine->graph, &routing);
+    }
+    engine->routing = routing;
+    int ok = bank_set_load_config(&engine->banks, &store, engine->sound_dir, &engine->routing);
+    config_store_free(&store);
+    return ok;
+}
+// Settings the daemon needs before it can start: memory budget and buses
+static size_t read_startup_config(const char *config_path, Routing *routing) {
+    ConfigStore store;
+    size_t megabytes = 256;
+    if (config_store_load(&store, config_path)) {
+        megabytes = (size_t)atol(config_store_option(&store, "engine:bank_budget_mb", "256"));
+        routing_load(routing, &store);
+        config_store_free(&store);
+    } else {
+        ConfigStore empty = {0};
+        routing_load(routing, &empty);
+    }
+    return (megabytes ? megabytes : 256) << 20;
+}
+static KeyState *key_state(Engine *engine, const char *key) {
+    int oldest = 0;
+    for (int i = 0; i < engine->key_count; i++) {
+        if (strcmp(engine->keys[i].key, key) == 0) return &engine->keys[i];
+        if (engine->keys[i].last_press < engine->keys[oldest].last_press) oldest = i;
+    }
+    KeyState *state = &engine->keys[engine->key_count < ENGINE_MAX_KEYS ? engine->key_count++ : oldest];
+    memset(state, 0, sizeof(*state));
+    snprintf(state->key, sizeof(state->key), "%s", key);
+    return state;
+}
+// X auto-repeat on a held key arrives as release+press pairs a few ms apart,
+// each one a separate xbindkeys command that may reach us in either order.
+// A press is a repeat if it follows a release almost immediately, or if the
+// key is still down (its release has not arrived yet).
+static int is_key_repeat(Engine *engine, const char *key) {
+    KeyState *state = key_state(engine, key);
+    double now = now_seconds();
+    int repeat = engine->autorepeat > 0 &&
+                 (now - state->last_release < engine->autorepeat ||
+                  (state->has_release && state->last_press > state->last_release &&
+                   now - state->last_press < ENGINE_HELD_TIMEOUT));
+    state->last_press = now;
+    return repeat;
+}
+static void key_released(Engine *engine, const char *key) {
+    KeyState *state = key_state(engine, key);
+    state->last_release = now_seconds();
+    state->has_release = 1;
+}
+// Start a voice. A paged-out sample is handed to the loader thread, which
+// decodes and starts it, so a slow decode never holds up other commands.
+// Sinks are not checked here: the graph keeps them alive and the mixer
+// reopens a bus as soon as its sink is back. Returns 0 if the sound will not play.
+static int trigger(Engine *engine, Sample *sample, const float *gains, int retrigger,
+                    char *reply, size_t reply_size) {
+    if (!sample_cache_acquire(&engine->cache, sample)) {
+        pthread_mutex_lock(&engine->cache.lock);
+        engine->cache.misses++;
+        pthread_mutex_unlock(&engine->cache.lock);
+        prefetch_note_trigger(&engine->prefetch, sample->path);
+        if (bank_set_play_later(&engine->banks, sample, gains, retrigger)) {
+            snprintf(reply, reply_size, "Loading: %s", sample->path);
+            return 1;
+        }
+        snprintf(reply, reply_size, "Too many sounds loading, dropped %s", sample->path);
+        return 0;
+    }
+    // Our pin keeps the loader from evicting the sample until the voice holds its own
+    int result = mixer_play(&engine->mixer, sample, gains, retrigger);
+    sample_cache_release(&engine->cache, sample);
+    switch (result) {
+        case PLAY_STARTED:
+            snprintf(reply, reply_size, "Playing: %s", sample->path);
+            break;
+        case PLAY_STOLE:
+            snprintf(reply, reply_size, "Playing (voice stolen): %s", sample->path);
+            break;
+        case PLAY_RESTARTED:
+            snprintf(reply, reply_size, "Restarted: %s", sample->path);
+            break;
+        case PLAY_IGNORED:
+            snprintf(reply, reply_size, "Already playing: %s", sample->path);
+            break;
+        case PLAY_STOPPED:
+            snprintf(reply, reply_size, "Stopped: %s", sample->path);
+            break;
+        case PLAY_SUSPENDED:
+            snprintf(reply, reply_size, "Virtual microphone is removed. Run 'soundboard setup' first.");
+            return 0;
+        default:
+            snprintf(reply, reply_size, "Could not play %s (paged out)", sample->path);
+            return 0;
+    }
+    return 1;
+}
+static void describe_buses(Engine *engine, char *reply, size_t reply_size) {
+    size_t used = 0;
+    reply[0] = '\0';
+    for (int b = 0; b < engine->routing.bus_count && used < reply_size; b++) {
+        Bus *bus = &engine->routing.buses[b];
+        used += snprintf(reply + used, reply_size - used, "%s%s -> %s (gain %.2f, %s)",
+                         b ? "; " : "", bus->name, bus->sink, bus->default_gain,
+                         mixer_bus_ready(&engine->mixer, b) ? "ok" : "missing");
+    }
+}
+// Server thread: a refresh found sinks, reopen the buses that lost theirs
+static void graph_changed(void *data, unsigned bus_sinks_present) {
+    Engine *engine = data;
+    if (!engine->graph.wanted) return;  // torn down: the mixer stays closed (mainloop lock is held here)
+    for (int b = 0; b < ROUTING_MAX_BUSES; b++) {
+        if ((bus_sinks_present & (1u << b)) && !mixer_bus_ready(&engine->mixer, b)) {
+            mixer_reopen(&engine->mixer);
+            return;
+        }
+    }
+}
+// Returns 0 if the command failed; the reply text says why
+static int handle_command(Engine *engine, char *command, char *reply, size_t reply_size) {
+    char *verb = strtok(command, " \t\r\n");
+    char *arg1 = strtok(NULL, " \t\r\n");
+    char *arg2 = strtok(NULL, " \t\r\n");
+    int ok = 1;
+    if (!verb) {
+        snprintf(reply, reply_size, "Empty command");
+        ok = 0;
+    } else if (strcmp(verb, "ping") == 0) {
+        snprintf(reply, reply_size, "pong");
+    } else if (strcmp(verb, "key") == 0 && arg1) {
+        Bank *bank = bank_set_active(&engine->banks);
+        KeySlot *slot = bank_lookup_key(bank, arg1);
+        if (is_key_repeat(engine, arg1)) {
+            engine->repeats++;
+            snprintf(reply, reply_size, "Ignored auto-repeat of %s", arg1);
+        } else if (!slot) {
+            snprintf(reply, reply_size, "Key %s is not bound in bank %d", arg1, bank ? bank->number : 0);
+            ok = 0;
+        } else {
+            ok = trigger(engine, slot->sample, slot->gains, slot->retrigger, reply, reply_size);
+        }
+    } else if (strcmp(verb, "release") == 0 && arg1) {
+        key_released(engine, arg1);
+        snprintf(reply, reply_size, "ok");
+    } else if (strcmp(verb, "play") == 0 && arg1) {
+        SoundSlot *sound = bank_set_find_sound(&engine->banks, arg1);
+        float gains[ROUTING_MAX_BUSES];
+        if (!sound) {
+            snprintf(reply, reply_size, "Sound #%s not found in config!", arg1);
+            ok = 0;
+        } else if (arg2 && !routing_parse_mode(&engine->routing, arg2, gains)) {
+            snprintf(reply, reply_size, "No such bus in '%s'. Run 'soundboardd buses' to list them.", arg2);
+            ok = 0;
+        } else {
+            ok = trigger(engine, sound->sample, arg2 ? gains : sound->gains, sound->retrigger, reply, reply_size);
+        }
+    } else if (strcmp(verb, "bank") == 0 && !arg1) {
+        Bank *active = bank_set_active(&engine->banks);
+        snprintf(reply, reply_size, "bank %d", active ? active->number : 0);
+    } else if (strcmp(verb, "bank") == 0) {
+        Bank *active = bank_set_active(&engine->banks);
+        int number = active ? active->number : 1;
+        char *end = NULL;
+        if (strcmp(arg1, "next") == 0) number++;
+        else if (strcmp(arg1, "prev") == 0) number--;
+        else number = (int)strtol(arg1, &end, 10);
+        // next/prev wrap around; an explicit number has to exist
+        if (end && (*end || end == arg1 || number < 1 || number > engine->banks.bank_count)) {
+            snprintf(reply, reply_size, "No bank %s, banks are 1 to %d", arg1, engine->banks.bank_count);
+            ok = 0;
+        } else {
+            Bank *bank = bank_set_switch(&engine->banks, number);
+            snprintf(reply, reply_size, "bank %d", bank ? bank->number : 0);
+        }
+    } else if (strcmp(verb, "stop") == 0) {
+        mixer_stop_all(&engine->mixer);
+        snprintf(reply, reply_size, "All sounds stopped.");
+    } else if (strcmp(verb, "reload") == 0) {
+        ok = load_config(engine);
+        snprintf(reply, reply_size, ok ? "Config reloaded" : "Config reload failed");
+    } else if (strcmp(verb, "status") == 0) {
+        Bank *active = bank_set_active(&engine->banks);
+        Mixer *mixer = &engine->mixer;
+        pthread_mutex_lock(&mixer->lock);
+        int voices = mixer->voice_count, polyphony = mixer->polyphony;
+        unsigned long triggers = mixer->triggers, stolen = mixer->stolen, restarted = mixer->restarted,
+                      ignored = mixer->ignored, toggled_off = mixer->toggled_off;
+        pthread_mutex_unlock(&mixer->lock);
+        Prefetch *prefetch = &engine->prefetch;
+        pthread_mutex_lock(&prefetch->lock);
+        unsigned long warm_files = prefetch->warm_files, cold_pages = prefetch->cold_triggers;
+        size_t warm_bytes = prefetch->warm_bytes, pinned_bytes = prefetch->pinned_bytes;
+        pthread_mutex_unlock(&prefetch->lock);
+        pthread_mutex_lock(&engine->cache.lock);
+        snprintf(reply, reply_size,
+                 "bank %d/%d, %zu MB resident (%zu MB as float, budget %zu MB), %lu decodes, %lu cold triggers "
+                 "(%lu read uncached pages), %lu files warm (%zu MB, %zu MB pinned), "
+                 "%d/%d voices, %lu triggers (%lu stolen, %lu restarted, %lu ignored, %lu toggled off, %lu key repeats)",
+                 active ? active->number : 0, engine->banks.bank_count,
+                 engine->cache.resident_bytes >> 20,
+                 (engine->cache.resident_frames * SAMPLE_CHANNELS * sizeof(float)) >> 20,
+                 engine->banks.budget >> 20,
+                 engine->cache.decodes, engine->cache.misses, cold_pages, warm_files, warm_bytes >> 20,
+                 pinned_bytes >> 20, voices, polyphony,
+                 triggers, stolen, restarted, ignored, toggled_off, engine->repeats);
+        pthread_mutex_unlock(&engine->cache.lock);
+    } else if (strcmp(verb, "warm") == 0) {
+        bank_set_warm(&engine->banks);
+        snprintf(reply, reply_size, "Warming sound files");
+    } else if (strcmp(verb, "buses") == 0) {
+        describe_buses(engine, reply, reply_size);
+    } else if (strcmp(verb, "setup") == 0) {
+        int connected = audio_graph_setup(&engine->graph);
+        mixer_suspend(&engine->mixer, 0);  // the graph keeps the sinks wanted from here on
+        if (connected) {
+            audio_graph_describe(&engine->graph, reply, reply_size);
+        } else {
+            snprintf(reply, reply_size, "Audio server not reachable, devices will be created once it is");
+            ok = 0;
+        }
+    } else if (strcmp(verb, "teardown") == 0) {
+        // Close our streams first, or the server moves them to the speakers
+        mixer_suspend(&engine->mixer, 1);
+        ok = audio_graph_teardown(&engine->graph);
+        snprintf(reply, reply_size, ok ? "Virtual microphone removed" : "Audio server not reachable");
+    } else if (strcmp(verb, "graph") == 0) {
+        audio_graph_describe(&engine->graph, reply, reply_size);
+    } else if (strcmp(verb, "quit") == 0) {
+        keep_running = 0;
+        snprintf(reply, reply_size, "Shutting down");
+    } else {
+        snprintf(reply, reply_size, "Unknown command: %s", verb);
+        ok = 0;
+    }
+    return ok;
+}
+static int open_socket(void) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    engine_socket_path(addr.sun_path, sizeof(addr.sun_path));
+    // Held for the daemon's lifetime, so two hotkeys starting it at once get one daemon
+    char lock_path[sizeof(addr.sun_path) + 8];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", addr.sun_path);
+    int lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd >= 0 && flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        printf("soundboardd is already running.\n");
+        close(lock_fd);
+        return -1;
+    }
+    if (engine_send("ping", NULL, 0)) {
+        printf("soundboardd is already running.\n");
+        return -1;
+    }
+    unlink(addr.sun_path);  // stale socket from a crashed daemon
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("Error: Could not create engine socket %s: %s\n", addr.sun_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+static int run_daemon(const char *config_path) {
+    static Engine engine;
+    snprintf(engine.config_path, sizeof(engine.config_path), "%s", config_path);
+    char dir_copy[1024];
+    snprintf(dir_copy, sizeof(dir_copy), "%s", config_path);
+    snprintf(engine.sound_dir, sizeof(engine.sound_dir), "%s", dirname(dir_copy));
+
+    int fd = open_socket();
+    if (fd < 0) return 1;
+    // No SA_RESTART: a signal must interrupt recvfrom so we can shut down
+    struct sigaction action = {0};
+    action.sa_handler = handle_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    sample_cache_init(&engine.cache);
+    prefetch_init(&engine.prefetch);
+    size_t budget = read_startup_config(config_path, &engine.routing);
+    if (!bank_set_start(&engine.banks, &engine.cache, &engine.prefetch, &engine.mixer, budget) ||
+        !mixer_start(&engine.mixer, &engine.cache, &engine.routing) ||
+        !audio_graph_start(&engine.graph, &engine.routing, graph_changed, &engine)) {
+        char socket_path[108];
+        engine_socket_path(socket_path, sizeof(socket_path));
+        unlink(socket_path);
+        close(fd);
+        return 1;
+    }
+    load_config(&engine);
+    if (!audio_graph_wait_connected(&engine.graph, ENGINE_SERVER_WAIT_MS) || !audio_graph_setup(&engine.graph)) {
+        printf("Warning: Audio server not reachable yet, devices will be created once it is\n");
+    }
+    printf("soundboardd ready\n");
+    while (keep_running) {
+        char command[ENGINE_COMMAND_MAX];
+        char reply[ENGINE_COMMAND_MAX];
+        char datagram[ENGINE_COMMAND_MAX + 8];
+        struct sockaddr_un client;
+        socklen_t client_len = sizeof(client);
+        ssize_t len = recvfrom(fd, command, sizeof(command) - 1, 0,
+                               (struct sockaddr *)&client, &client_len);
+        if (len < 0) continue;  // EINTR, checked by the loop condition
+        command[len] = '\0';
+        int ok = handle_command(&engine, command, reply, sizeof(reply));
+        if (client_len > sizeof(sa_family_t)) {
+            int length = snprintf(datagram, sizeof(datagram), "%s %s", ok ? ENGINE_REPLY_OK : ENGINE_REPLY_ERROR, reply);
+            sendto(fd, datagram, length, MSG_DONTWAIT, (struct sockaddr *)&client, client_len);
+        }
+    }
+    char socket_path[108];
+    engine_socket_path(socket_path, sizeof(socket_path));
+    unlink(socket_path);
+    close(fd);
+    mixer_shutdown(&engine.mixer);
+    audio_graph_stop(&engine.graph);
+    bank_set_stop(&engine.banks);
+    prefetch_destroy(&engine.prefetch);
+    sample_cache_destroy(&engine.cache);
+    printf("soundboardd stopped\n");
+    return 0;
+}
+// Client side of "stress": fire one command count times at rate per second,
+// then summarise the replies and the engine's own counters
+static int run_stress(int count, double rate, const char *command) {
+    struct {
+        char reply[48];
+        int count;
+    } kinds[8];
+    int kind_count = 0, failed = 0;
+    double worst = 0, total = 0;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    double start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        long step = (long)(1e9 / rate);
+        next.tv_nsec += step;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        char reply[ENGINE_COMMAND_MAX];
+        double sent = now_seconds();
+        if (!engine_send(command, reply, sizeof(reply))) {
+            failed++;
+            continue;
+        }
+        double latency = now_seconds() - sent;
+        total += latency;
+        if (latency > worst) worst = latency;
+        reply[strcspn(reply, ":")] = '\0';  // "Playing: <path>" -> "Playing"
+        int k = 0;
+        while (k < kind_count && strncmp(kinds[k].reply, reply, sizeof(kinds[k].reply) - 1) != 0) k++;
+        if (k == kind_count && kind_count < 8) {
+            snprintf(kinds[k].reply, sizeof(kinds[k].reply), "%.47s", reply);
+            kinds[k].count = 0;
+            kind_count++;
+        }
+        if (k < kind_count) kinds[k].count++;
+    }
+    double elapsed = now_seconds() - start;
+    int answered = count - failed;
+    printf("%d commands in %.2f s (%.0f/s), %d unanswered, reply latency avg %.2f ms, max %.2f ms\n",
+           count, elapsed, count / elapsed, failed, answered ? total / answered * 1e3 : 0.0, worst * 1e3);
+    for (int k = 0; k < kind_count; k++) {
+        printf("  %6d  %s\n", kinds[k].count, kinds[k].reply);
+    }
+    char status[ENGINE_COMMAND_MAX];
+    if (!engine_send("status", status, sizeof(status))) {
+        printf("Error: Engine stopped answering after the stress run\n");
+        return 1;
+    }
+    printf("%s\n", status);
+    return failed ? 1 : 0;
+}
+// A hotkey found no daemon (after login, a crash or cleanup): start one in
+// the background and wait until it answers
+static int start_daemon(const char *config_path) {
+    char self[1024];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len <= 0 || !config_path[0]) return 0;
+    self[len] = '\0';
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        // Double fork so the daemon is not left as our child
+        setsid();
+        int null = open("/dev/null", O_RDWR);
+        if (null >= 0) {
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        if (fork() == 0) execl(self, self, "-c", config_path, (char *)NULL);
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+    double deadline = now_seconds() + ENGINE_START_WAIT_MS / 1000.0;
+    while (now_seconds() < deadline) {
+        if (engine_request("ping", NULL, 0) == ENGINE_OK) return 1;
+        usleep(100000);
+    }
+    return 0;
+}
+int main(int argc, char *argv[]) {
+    char config_path[1024] = "";
+    int arg = 1;
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+        snprintf(config_path, sizeof(config_path), "%s", argv[2]);
+        arg = 3;
+    } else if (getenv("HOME")) {
+        snprintf(config_path, sizeof(config_path), "%s/soundboard/config.txt", getenv("HOME"));
+    }
+    if (arg == argc) {
+        if (!config_path[0]) {
+            printf("Error: HOME environment variable not set\n");
+            return 1;
+        }
+        return run_daemon(config_path);
+    }
+    // Client mode: forward the arguments as one command line
+    int first = argc - arg >= 4 && strcmp(argv[arg], "stress") == 0 ? arg + 3 : arg;
+    char command[ENGINE_COMMAND_MAX] = "";
+    for (int i = first; i < argc; i++) {
+        if (i > first) strncat(command, " ", sizeof(command) - strlen(command) - 1);
+        strncat(command, argv[i], sizeof(command) - strlen(command) - 1);
+    }
+    if (first != arg) {
+        int count = atoi(argv[arg + 1]);
+        double rate = atof(argv[arg + 2]);
+        if (count <= 0 || rate <= 0) {
+            printf("Usage: soundboardd stress <count> <per second> <command...>\n");
+            return 1;
+        }
+        return run_stress(count, rate, command);
+    }
+    char reply[ENGINE_COMMAND_MAX];
+    int result = engine_request(command, reply, sizeof(reply));
+    if (result == ENGINE_DOWN && (strcmp(argv[arg], "key") == 0 || strcmp(argv[arg], "bank") == 0) &&
+        start_daemon(config_path)) {
+        result = engine_request(command, reply, sizeof(reply));
+    }
+    if (result == ENGINE_DOWN) {
+        fprintf(stderr, "soundboardd is not running. Run 'soundboard setup' first.\n");
+        return CLIENT_EXIT_DOWN;
+    }
+    if (result == ENGINE_NO_REPLY) {
+        fprintf(stderr, "soundboardd did not answer in time.\n");
+        return CLIENT_EXIT_NO_REPLY;
+    }
+    printf("%s\n", reply);
+    return result == ENGINE_ERROR ? 1 : 0;
+}
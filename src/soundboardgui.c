@@ -3,8 +3,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <spawn.h>
 #include <sys/wait.h>
+#include <signal.h>
+#include <dirent.h>
 #include <pango/pango.h>
+#include "config_store.h"
+#include "engine_client.h"
+extern char **environ;
 // Global variable to track if we're waiting for a key
 static gboolean waiting_for_key = FALSE;
 static int pending_sound_id = 0;
@@ -95,6 +101,7 @@ typedef struct {
     char *filename;
     char *keybind;
     char *description;
+    int bank;          // bank the keybind belongs to (1 when unbound)
 } SoundInfo;
 // Structure to hold all our GUI data
 typedef struct {
@@ -104,6 +111,10 @@ typedef struct {
     SoundInfo *sounds;
     int sound_count;
     int grid_columns;
+    GtkWidget *bank_label;
+    int bank;          // bank shown in the grid
+    int bank_count;    // highest bank that has a keybind
+    int engine_bank;   // engine's active bank when last asked (0 = no engine)
 } AppData;
 // Global app data
 AppData app_data = {0};
@@ -228,6 +239,103 @@ void setup_callback(GtkWidget *widget, gpointer data) {
         printf("Setup command executed successfully\n");
     }
 }
+// Send a signal to every running xbindkeys; returns how many there were
+static int signal_xbindkeys(int sig) {
+    int count = 0;
+    DIR *proc = opendir("/proc");
+    if (!proc) return 0;
+    struct dirent *ent;
+    while ((ent = readdir(proc)) != NULL) {
+        char comm_path[300], comm[64] = "";
+        pid_t pid = (pid_t)atoi(ent->d_name);
+        if (pid <= 0) continue;
+        snprintf(comm_path, sizeof(comm_path), "/proc/%s/comm", ent->d_name);
+        FILE *file = fopen(comm_path, "r");
+        if (!file) continue;
+        if (fgets(comm, sizeof(comm), file) && strcmp(comm, "xbindkeys\n") == 0) {
+            kill(pid, sig);
+            count++;
+        }
+        fclose(file);
+    }
+    closedir(proc);
+    return count;
+}
+// Ask every running xbindkeys to re-read its rc file (SIGHUP reloads it in place)
+static void reload_xbindkeys() {
+    signal_xbindkeys(SIGHUP);
+}
+// xbindkeys grabs the bound keys, so while waiting for a key to bind only it is
+// stopped; the engine and the virtual devices stay up
+static gboolean xbindkeys_suspended = FALSE;
+static void suspend_xbindkeys() {
+    xbindkeys_suspended = signal_xbindkeys(SIGTERM) > 0;
+}
+static void resume_xbindkeys() {
+    if (!xbindkeys_suspended) return;
+    xbindkeys_suspended = FALSE;
+    char *argv[] = {"xbindkeys", NULL};
+    pid_t pid;
+    // xbindkeys puts itself in the background, so this returns right away
+    if (posix_spawnp(&pid, "xbindkeys", NULL, NULL, argv, environ) != 0) {
+        printf("Warning: Could not restart xbindkeys\n");
+        return;
+    }
+    waitpid(pid, NULL, 0);
+}
+// soundboardd ships next to the GUI; returns NULL when it is not available
+static const char *find_engine_path() {
+    static char engine_path[1024];
+    char exe_path[1024];
+    ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    if (len <= 0) return NULL;
+    exe_path[len] = '\0';
+    char *slash = strrchr(exe_path, '/');
+    if (slash) *slash = '\0';
+    snprintf(engine_path, sizeof(engine_path), "%s/soundboardd", exe_path);
+    return access(engine_path, X_OK) == 0 ? engine_path : NULL;
+}
+// Apply a keybind change through the shared config store, then regenerate ~/.xbindkeysrc
+// sound_id_str is the config ID ("5" or "stop"); keybind NULL means unbind
+static int update_keybind(const char *sound_id_str, const char *keybind) {
+    const char *home = getenv("HOME");
+    if (!home) {
+        printf("Error: HOME environment variable not set\n");
+        return 0;
+    }
+    char config_path[1024], sound_dir[1024], script_path[1024], xbindkeys_path[1024];
+    snprintf(sound_dir, sizeof(sound_dir), "%s/soundboard", home);
+    snprintf(config_path, sizeof(config_path), "%s/config.txt", sound_dir);
+    snprintf(script_path, sizeof(script_path), "%s/soundboard.sh", sound_dir);
+    snprintf(xbindkeys_path, sizeof(xbindkeys_path), "%s/.xbindkeysrc", home);
+    ConfigStore store;
+    if (!config_store_load(&store, config_path)) {
+        return 0;
+    }
+    int result, ok = 0;
+    if (keybind) {
+        char **cleared_ids = NULL;
+        result = config_store_bind(&store, sound_id_str, keybind, &cleared_ids);
+        for (int i = 0; result == CONFIG_OK && cleared_ids && cleared_ids[i]; i++) {
+            printf("Removed conflicting keybind '%s' from sound #%s\n", keybind, cleared_ids[i]);
+        }
+        config_store_free_ids(cleared_ids);
+    } else {
+        result = config_store_unbind(&store, sound_id_str);
+    }
+    if (result == CONFIG_NOT_FOUND) {
+        printf("Sound ID %s not found!\n", sound_id_str);
+    } else if (result == CONFIG_OK) {
+        ok = config_store_save(&store) &&
+             config_store_write_xbindkeys(&store, sound_dir, script_path, find_engine_path(), xbindkeys_path);
+    }
+    config_store_free(&store);
+    if (ok) {
+        engine_send("reload", NULL, 0);
+        reload_xbindkeys();
+    }
+    return ok;
+}
 // Key press event handler
 static gboolean on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer user_data) {
     if (!waiting_for_key) {
@@ -239,35 +347,29 @@ static gboolean on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer use
         g_print("Key binding canceled\n");
         waiting_for_key = FALSE;
         pending_sound_id = 0;
-        setup_callback(NULL, NULL);
+        resume_xbindkeys();
         return TRUE;
     }
     if (key_string == NULL) {
         g_print("Unsupported key pressed. Try again or press Escape to cancel.\n");
         return TRUE; // Consume the event but don't process it
     }
-    // We got a valid key, now send the bind command
-    char command[1024];
-    const char *home = getenv("HOME");
-    if (!home) {
-        printf("Error: HOME environment variable not set\n");
-        waiting_for_key = FALSE;
-        return TRUE;
-    }
-    snprintf(command, sizeof(command), "%s/soundboard/soundboard.sh bind %d %s", home, pending_sound_id, key_string);
-    printf("Binding key '%s' to sound ID %d\n", key_string, pending_sound_id);
-    printf("Executing: %s\n", command);
-    // Execute the command
-    int result = system(command);
-    if (result == -1) {
-        printf("Error: Failed to execute command\n");
-    } else if (result != 0) {
-        printf("Command failed with exit code: %d\n", WEXITSTATUS(result));
+    // We got a valid key, now update the config directly (bank 1 keys have no prefix)
+    char sound_id_str[16], keybind[64];
+    snprintf(sound_id_str, sizeof(sound_id_str), "%d", pending_sound_id);
+    if (app_data.bank > 1) {
+        snprintf(keybind, sizeof(keybind), "%d:%s", app_data.bank, key_string);
     } else {
+        snprintf(keybind, sizeof(keybind), "%s", key_string);
+    }
+    printf("Binding key '%s' to sound ID %d\n", keybind, pending_sound_id);
+    if (update_keybind(sound_id_str, keybind)) {
         printf("Key binding successful!\n");
+    } else {
+        printf("Error: Key binding failed\n");
     }
-    // Call setup to restart xbindkeys with new configuration
-    setup_callback(NULL, NULL);
+    // update_keybind already rewrote the rc file, so xbindkeys starts with the new binding
+    resume_xbindkeys();
     // Reset the waiting state
     waiting_for_key = FALSE;
     pending_sound_id = 0;
@@ -285,7 +387,7 @@ void play_sound_callback(GtkWidget *widget, gpointer data) {
         return;
     }
     // Build the full path to the script
-    snprintf(command, sizeof(command), "%s/soundboard/soundboard.sh %d both", home, sound_id);
+    snprintf(command, sizeof(command), "%s/soundboard/soundboard.sh %d", home, sound_id);
     printf("Executing: %s\n", command);
     // First check if the script exists and is executable
     char script_path[1024];  // Increased buffer size
@@ -366,6 +468,10 @@ int parse_config_line(const char *line, SoundInfo *sound) {
     }
     free(line_copy);
     int success = (field >= 4);
+    if (success) {
+        const char *key;
+        sound->bank = config_keybind_bank(sound->keybind, &key);
+    }
     if (!success) {
         // Clean up any allocated memory if parsing failed
         free(sound->filename);
@@ -420,8 +526,13 @@ int load_sounds_from_config() {
     // Second pass: actually load the sounds
     rewind(file);
     app_data.sound_count = 0;
+    app_data.bank_count = 1;
     while (fgets(line, sizeof(line), file) && app_data.sound_count < count) {
         if (parse_config_line(line, &app_data.sounds[app_data.sound_count])) {
+            SoundInfo *sound = &app_data.sounds[app_data.sound_count];
+            if (sound->keybind[0] && sound->bank > app_data.bank_count) {
+                app_data.bank_count = sound->bank;
+            }
             app_data.sound_count++;
         }
     }
@@ -480,12 +591,11 @@ gboolean on_middle_click(GtkWidget *widget, GdkEventButton *event, gpointer data
     if (event->type == GDK_BUTTON_PRESS && event->button == 2) {
         int sound_id = GPOINTER_TO_INT(data);
         g_print("Middle-click detected! Press a key to bind to sound %d (Escape to cancel)\n", sound_id);
-        // Call shutdown to stop xbindkeys before rebinding
-        shutdown_callback(NULL, NULL);
+        // Release xbindkeys' key grabs so the key reaches this window
+        if (!waiting_for_key) suspend_xbindkeys();
         // Set up waiting state
         waiting_for_key = TRUE;
         pending_sound_id = sound_id;
-        // Call setup to restart xbindkeys after binding is complete
         // Ensure the window has focus for key detection
         gtk_widget_grab_focus(app_data.window);
         return TRUE;  // Consume the middle click event
@@ -494,23 +604,15 @@ gboolean on_middle_click(GtkWidget *widget, GdkEventButton *event, gpointer data
 }
 //function for right click to unbind a sound
 gboolean on_right_click(GtkWidget *widget, GdkEventButton *event, gpointer data) {
-    const char *home = getenv("HOME");
-    if (!home) {
-        printf("Error: HOME environment variable not set\n");
-        return FALSE;
-    }
     if (event->type == GDK_BUTTON_PRESS && event->button == 3) {
         int sound_id = GPOINTER_TO_INT(data);
-        char command[1024];
-        snprintf(command, sizeof(command), "%s/soundboard/soundboard.sh unbind %d", home, sound_id);
-        printf("Executing: %s\n", command);
-        int result = system(command);
-        if (result == -1) {
-            printf("Error: Failed to execute unbind command\n");
-        } else if (result != 0) {
-            printf("unbind command failed with exit code: %d\n", WEXITSTATUS(result));
+        char sound_id_str[16];
+        snprintf(sound_id_str, sizeof(sound_id_str), "%d", sound_id);
+        printf("Unbinding sound ID %d\n", sound_id);
+        if (update_keybind(sound_id_str, NULL)) {
+            printf("unbind executed successfully\n");
         } else {
-            printf("unbind command executed successfully\n");
+            printf("Error: unbind failed\n");
         }
         return TRUE;
     }
@@ -532,9 +634,13 @@ void create_button_grid() {
     int window_width;
     gtk_window_get_size(GTK_WINDOW(app_data.window), &window_width, NULL);
     app_data.grid_columns = calculate_grid_columns(window_width, app_data.sound_count);
-    // Create buttons for each sound
+    // Create buttons for the sounds bound in this bank, plus unbound sounds so they can be bound here
+    int shown = 0;
     for (int i = 0; i < app_data.sound_count; i++) {
         SoundInfo *sound = &app_data.sounds[i];
+        if (sound->keybind && sound->keybind[0] && sound->bank != app_data.bank) {
+            continue;
+        }
         // Simple fallback for non-ASCII descriptions
         char button_label[64];
         const char *desc = (sound->description && strlen(sound->description) > 0)
@@ -578,14 +684,17 @@ void create_button_grid() {
         //Right click detection for unbinds
         g_signal_connect(button, "button-press-event", G_CALLBACK(on_right_click), GINT_TO_POINTER(sound->id));
         // Calculate grid position
-        int row = i / app_data.grid_columns;
-        int col = i % app_data.grid_columns;
+        int row = shown / app_data.grid_columns;
+        int col = shown % app_data.grid_columns;
+        shown++;
         // Add button to grid
         gtk_grid_attach(GTK_GRID(app_data.grid), button, col, row, 1, 1);
         // Create tooltip with full description and additional info
         char tooltip[512];  // Increased buffer size
-        const char *kb = (sound->keybind && strlen(sound->keybind) > 0)
-        ? sound->keybind : "none";
+        const char *kb = "none";
+        if (sound->keybind && strlen(sound->keybind) > 0) {
+            config_keybind_bank(sound->keybind, &kb);
+        }
         snprintf(tooltip, sizeof(tooltip), "Sound #%d\n%s\nFile: %s\nKeybind: %s",
                  sound->id,
                  sound->description ? sound->description : "No description",
@@ -641,6 +750,90 @@ void scan_callback(GtkWidget *widget, gpointer data) {
         refresh_grid();
     }
 }
+static void set_bank_shown(int bank) {
+    app_data.bank = bank;
+    char text[64];
+    if (bank > app_data.bank_count && app_data.engine_bank) {
+        // The engine has no such bank yet, so hotkeys keep playing its active one
+        snprintf(text, sizeof(text), "Bank %d (new, keys play bank %d)", bank, app_data.engine_bank);
+    } else {
+        snprintf(text, sizeof(text), "Bank %d", bank);
+    }
+    gtk_label_set_text(GTK_LABEL(app_data.bank_label), text);
+}
+// Bank commands go to the engine without blocking the GTK main loop: the reply
+// ("bank N") is picked up by an IO watch on the request socket.
+#define BANK_QUERY_TICKS 4   // poll ticks to wait for a busy engine before asking again
+static int bank_query_fd = -1;
+static guint bank_query_watch = 0;
+static int bank_query_switch;  // the request was a switch, not a poll
+static int bank_query_ticks;
+static void cancel_bank_query() {
+    if (bank_query_watch) g_source_remove(bank_query_watch);
+    if (bank_query_fd >= 0) close(bank_query_fd);
+    bank_query_watch = 0;
+    bank_query_fd = -1;
+}
+static gboolean on_bank_reply(GIOChannel *channel, GIOCondition condition, gpointer data) {
+    char reply[ENGINE_COMMAND_MAX];
+    int bank = 0;
+    if (engine_request_finish(bank_query_fd, reply, sizeof(reply)) == ENGINE_OK) {
+        sscanf(reply, "bank %d", &bank);
+    }
+    close(bank_query_fd);
+    bank_query_fd = -1;
+    bank_query_watch = 0;
+    if (!bank) return FALSE;  // refused (e.g. a bank the engine has not loaded yet)
+    // Follow hotkey switches, and correct the label when the engine wrapped a switch
+    int changed = (bank != app_data.engine_bank || (bank_query_switch && bank != app_data.bank));
+    app_data.engine_bank = bank;
+    if (changed && !waiting_for_key && bank != app_data.bank) {
+        set_bank_shown(bank);
+        refresh_grid();
+    }
+    return FALSE;  // one reply per request
+}
+static void send_bank_query(const char *command, int is_switch) {
+    cancel_bank_query();
+    bank_query_fd = engine_request_start(command);
+    if (bank_query_fd < 0) {
+        app_data.engine_bank = 0;  // no engine
+        return;
+    }
+    bank_query_switch = is_switch;
+    bank_query_ticks = 0;
+    GIOChannel *channel = g_io_channel_unix_new(bank_query_fd);
+    bank_query_watch = g_io_add_watch(channel, G_IO_IN | G_IO_ERR | G_IO_HUP, on_bank_reply, NULL);
+    g_io_channel_unref(channel);
+}
+// Show a bank in the grid and make it the engine's active bank.
+// One bank past the last used one is reachable so a new bank can be filled.
+static void show_bank(int bank) {
+    int last = app_data.bank_count < CONFIG_MAX_BANKS ? app_data.bank_count + 1 : CONFIG_MAX_BANKS;
+    if (bank < 1) bank = last;
+    if (bank > last) bank = 1;
+    if (bank <= app_data.bank_count) {
+        // The engine wraps numbers it does not know; its reply moves the label if it did
+        char command[32];
+        snprintf(command, sizeof(command), "bank %d", bank);
+        send_bank_query(command, 1);
+    }
+    set_bank_shown(bank);
+    refresh_grid();
+}
+// Follow bank switches made with hotkeys
+static gboolean poll_engine_bank(gpointer user_data) {
+    if (waiting_for_key) return TRUE;  // keep the grid still while binding
+    if (bank_query_fd >= 0 && ++bank_query_ticks < BANK_QUERY_TICKS) return TRUE;
+    send_bank_query("bank", 0);
+    return TRUE;
+}
+void bank_prev_callback(GtkWidget *widget, gpointer data) {
+    show_bank(app_data.bank - 1);
+}
+void bank_next_callback(GtkWidget *widget, gpointer data) {
+    show_bank(app_data.bank + 1);
+}
 // Callback for refresh button
 void refresh_callback(GtkWidget *widget, gpointer data) {
     printf("Refreshing sound list...\n");
@@ -738,10 +931,21 @@ void create_soundboard_gui() {
     GtkWidget *subtitle_hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
     gtk_container_set_border_width(GTK_CONTAINER(subtitle_hbox), 10);
     gtk_box_pack_start(GTK_BOX(main_vbox), subtitle_hbox, FALSE, FALSE, 0);
-    GtkWidget *subtitle_label = gtk_label_new("Middle click sound then keypress to rebind sound to key. Right click to unbind a sound.");
+    GtkWidget *subtitle_label = gtk_label_new("Middle click sound then keypress to bind it in the shown bank. Right click to unbind a sound.");
     gtk_box_pack_start(GTK_BOX(subtitle_hbox), subtitle_label, TRUE, TRUE, 0);
     gtk_widget_set_halign(subtitle_label, GTK_ALIGN_START);
     // Control buttons - arranged from left to right
+    // Bank selector
+    app_data.bank = 1;
+    GtkWidget *bank_prev_button = gtk_button_new_with_label("<");
+    gtk_box_pack_start(GTK_BOX(header_hbox), bank_prev_button, FALSE, FALSE, 0);
+    g_signal_connect(bank_prev_button, "clicked", G_CALLBACK(bank_prev_callback), NULL);
+    app_data.bank_label = gtk_label_new("Bank 1");
+    g_timeout_add(500, poll_engine_bank, NULL);
+    gtk_box_pack_start(GTK_BOX(header_hbox), app_data.bank_label, FALSE, FALSE, 0);
+    GtkWidget *bank_next_button = gtk_button_new_with_label(">");
+    gtk_box_pack_start(GTK_BOX(header_hbox), bank_next_button, FALSE, FALSE, 0);
+    g_signal_connect(bank_next_button, "clicked", G_CALLBACK(bank_next_callback), NULL);
     // Scan button (leftmost after title)
     GtkWidget *scan_button = gtk_button_new_with_label("Scan");
     gtk_box_pack_start(GTK_BOX(header_hbox), scan_button, FALSE, FALSE, 0);